@@ -0,0 +1,38 @@
+#version 330 core
+
+// the direction comes from FrameUniforms
+struct DirLight
+{
+    vec3 ambient;
+    vec3 diffuse;
+};
+
+in vec3 fragPos;
+in vec3 normal;
+in vec3 color;
+
+uniform DirLight dirLight;
+
+// see FrameUniformData
+layout (std140) uniform FrameUniforms
+{
+    mat4 proj;
+    mat4 view;
+    vec4 camPos;
+    vec4 dirLightDir;
+    vec4 pointLightPos;
+    float time;
+} frame;
+
+out vec4 fragColor;
+
+void main()
+{
+    vec3 n = normalize(normal);
+    vec3 lightDir = normalize(-frame.dirLightDir.xyz);
+
+    // blades are thin, light both faces alike
+    float diff = abs(dot(n, lightDir));
+
+    fragColor = vec4(dirLight.ambient * color + dirLight.diffuse * diff * color, 1.0);
+}
@@ -0,0 +1,80 @@
+#version 330 core
+
+// Unpacks GrassBlade (see grassField.h), one blade per instance. The blade itself
+// is a strip of SEGMENTS quads narrowing to a tip, built from gl_VertexID
+layout (location = 0) in vec4 aBlade;       // x, z (8.8 grid units), ground height, blade height
+layout (location = 1) in vec4 aVariation;   // rotation, wind phase, width, tint
+
+// see FrameUniformData
+layout (std140) uniform FrameUniforms
+{
+    mat4 proj;
+    mat4 view;
+    vec4 camPos;
+    vec4 dirLightDir;
+    vec4 pointLightPos;
+    float time;
+} frame;
+
+// world position of grid vertex (0, 0)
+uniform vec3 chunkOrigin;
+uniform float heightScale;
+uniform float maxBladeHeight;
+
+// blades of the chunk, gl_InstanceID / numBlades is the blade's priority
+uniform float numBlades;
+
+// density is 1 up to densityRange.x from the camera and falls to 0 at densityRange.y,
+// scaled by densityScale to keep to the instance budget. A blade shrinks away as its
+// priority gets within densityFade of the density, which is stretched by the fade so
+// every blade is full size at density 1
+uniform vec2 densityRange;
+uniform float densityScale;
+uniform float densityFade;
+
+uniform vec2 windDir;
+uniform float windStrength;
+
+const int SEGMENTS = 3;
+const float TWO_PI = 6.2831853;
+
+out vec3 fragPos;
+out vec3 normal;
+out vec3 color;
+
+void main()
+{
+    // two vertices per level, the last level is the single tip vertex
+    int level = gl_VertexID / 2;
+    float t = float(level) / float(SEGMENTS);
+    float side = level == SEGMENTS ? 0.0 : float(gl_VertexID % 2) * 2.0 - 1.0;
+
+    vec3 root = chunkOrigin + vec3(aBlade.x / 256.0, aBlade.z / 65535.0 * heightScale, aBlade.y / 256.0);
+
+    // same falloff as GrassRenderer::getDensity, a thinned out blade collapses onto its root
+    float density = (1.0 - smoothstep(densityRange.x, densityRange.y, distance(frame.camPos.xz, root.xz))) * densityScale;
+    float priority = (float(gl_InstanceID) + 0.5) / numBlades;
+    float lod = clamp((density * (1.0 + densityFade) - priority) / densityFade, 0.0, 1.0);
+
+    float bladeHeight = aBlade.w / 65535.0 * maxBladeHeight * lod;
+    float halfWidth = mix(0.02, 0.05, aVariation.z) * (1.0 - t) * lod;
+
+    float angle = aVariation.x * TWO_PI;
+    vec3 across = vec3(cos(angle), 0.0, sin(angle));
+    vec3 facing = vec3(-sin(angle), 0.0, cos(angle));
+
+    // the blade leans forward a little and sways with the wind, more towards the tip
+    float sway = sin(frame.time * 2.0 + aVariation.y * TWO_PI + dot(root.xz, windDir) * 0.05) * 0.5 + 0.5;
+    vec3 bend = facing * 0.3 + vec3(windDir.x, 0.0, windDir.y) * sway * windStrength;
+
+    fragPos = root + across * side * halfWidth + vec3(0.0, t * bladeHeight, 0.0) + bend * t * t * bladeHeight;
+
+    // terrain normals point down (see ChunkData), tilt the blade's the same way so it lights like the ground
+    normal = normalize(vec3(0.0, -1.0, 0.0) + facing * 0.5);
+
+    vec3 rootColor = vec3(0.05, 0.2, 0.05);
+    vec3 tipColor = vec3(0.3, 0.6, 0.15);
+    color = mix(rootColor, tipColor, t) * (0.8 + 0.4 * aVariation.w);
+
+    gl_Position = frame.proj * frame.view * vec4(fragPos, 1.0);
+}
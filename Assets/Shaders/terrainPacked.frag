@@ -0,0 +1,77 @@
+#version 330 core
+
+// directions and positions come from FrameUniforms
+struct DirLight
+{
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight
+{
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+in vec3 fragPos;
+in vec3 normal;
+in vec3 color;
+
+uniform DirLight dirLight;
+uniform PointLight pointLight;
+
+// see FrameUniformData
+layout (std140) uniform FrameUniforms
+{
+    mat4 proj;
+    mat4 view;
+    vec4 camPos;
+    vec4 dirLightDir;
+    vec4 pointLightPos;
+    float time;
+} frame;
+
+out vec4 fragColor;
+
+vec3 calcDirLight(vec3 n, vec3 viewDir)
+{
+    vec3 lightDir = normalize(-frame.dirLightDir.xyz);
+    vec3 reflectDir = reflect(-lightDir, n);
+
+    float diff = max(dot(n, lightDir), 0.0);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+
+    return dirLight.ambient * color +
+           dirLight.diffuse * diff * color +
+           dirLight.specular * spec;
+}
+
+vec3 calcPointLight(vec3 n, vec3 viewDir)
+{
+    vec3 lightDir = normalize(frame.pointLightPos.xyz - fragPos);
+    vec3 reflectDir = reflect(-lightDir, n);
+
+    float diff = max(dot(n, lightDir), 0.0);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+
+    float dist = length(frame.pointLightPos.xyz - fragPos);
+    float attenuation = 1.0 / (pointLight.constant + pointLight.linear * dist + pointLight.quadratic * dist * dist);
+
+    return (pointLight.ambient * color +
+            pointLight.diffuse * diff * color +
+            pointLight.specular * spec) * attenuation;
+}
+
+void main()
+{
+    vec3 n = normalize(normal);
+    vec3 viewDir = normalize(frame.camPos.xyz - fragPos);
+
+    fragColor = vec4(calcDirLight(n, viewDir) + calcPointLight(n, viewDir), 1.0);
+}
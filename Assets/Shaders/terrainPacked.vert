@@ -0,0 +1,85 @@
+#version 330 core
+
+// Unpacks TerrainVertex (see chunkData.h)
+layout (location = 0) in float aHeight;
+layout (location = 1) in vec2 aGrid;
+layout (location = 2) in vec2 aNormal;
+layout (location = 3) in float aMorphHeight;
+
+// TerrainDrawData of the chunk being drawn, one instance per draw
+layout (location = 4) in vec4 aChunk;        // world position of grid vertex (0, 0), height scale
+layout (location = 5) in vec2 aMorphRange;   // distances over which this level blends towards the next
+layout (location = 6) in ivec2 aLod;         // level the chunk is drawn at, (WorldConfig::terrainSize + 2)
+
+// see FrameUniformData
+layout (std140) uniform FrameUniforms
+{
+    mat4 proj;
+    mat4 view;
+    vec4 camPos;
+    vec4 dirLightDir;
+    vec4 pointLightPos;
+    float time;
+} frame;
+
+// number of LOD levels, see TerrainIndexBuffer
+uniform int maxLodLevels;
+
+out vec3 fragPos;
+out vec3 normal;
+out vec3 color;
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e.x, 1.0 - abs(e.x) - abs(e.y), e.y);
+    float t = max(-n.y, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.z += n.z >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+// mirrors ChunkData::getLineLevel
+int getLineLevel(int line)
+{
+    int level = 0;
+    while(level < maxLodLevels - 1 && (line & 1) == 0)
+    {
+        line >>= 1;
+        level++;
+    }
+    return level;
+}
+
+// mirrors ChunkData::getVertexLevel
+int getVertexLevel(ivec2 grid, int gridSize)
+{
+    if(grid.x == 0 || grid.y == 0 || grid.x == gridSize - 1 || grid.y == gridSize - 1)
+    {
+        return maxLodLevels;
+    }
+    return min(getLineLevel(grid.x), getLineLevel(grid.y));
+}
+
+void main()
+{
+    vec3 chunkOrigin = aChunk.xyz;
+    float heightScale = aChunk.w;
+
+    float height = aHeight;
+
+    // vertices the next level drops slide onto its surface before the switch
+    if(getVertexLevel(ivec2(aGrid), aLod.y) == aLod.x)
+    {
+        vec3 flatPos = chunkOrigin + vec3(aGrid.x, 0.0, aGrid.y);
+        float dist = length(flatPos.xz - frame.camPos.xz);
+        float morph = clamp((dist - aMorphRange.x) / (aMorphRange.y - aMorphRange.x), 0.0, 1.0);
+
+        height = mix(aHeight, aMorphHeight, morph);
+    }
+
+    fragPos = chunkOrigin + vec3(aGrid.x, height * heightScale, aGrid.y);
+    normal = decodeOctahedral(aNormal);
+    color = vec3(0.2, 0.2 + height, 0.4);
+
+    gl_Position = frame.proj * frame.view * vec4(fragPos, 1.0);
+}
@@ -0,0 +1,163 @@
+#ifndef BENCH_UTILS_H
+#define BENCH_UTILS_H
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+typedef std::chrono::steady_clock Clock;
+
+inline double elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// peak resident set size of the process so far
+inline size_t getPeakRSSBytes()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    //kilobytes on linux
+    return (size_t)usage.ru_maxrss * 1024;
+}
+
+struct SampleStats
+{
+    size_t count = 0;
+    double mean = 0;
+    double median = 0;
+    double p95 = 0;
+    double min = 0;
+    double max = 0;
+    double total = 0;
+};
+
+inline SampleStats computeStats(std::vector<double> samples)
+{
+    SampleStats stats;
+    if(samples.empty()) return stats;
+
+    std::sort(samples.begin(), samples.end());
+
+    stats.count = samples.size();
+    for(double sample : samples)
+    {
+        stats.total += sample;
+    }
+    stats.mean = stats.total / samples.size();
+
+    size_t middle = samples.size() / 2;
+    stats.median = samples.size() % 2 ? samples[middle] : (samples[middle - 1] + samples[middle]) / 2;
+
+    //nearest rank
+    size_t rank = (size_t)(0.95 * samples.size() + 0.999999);
+    stats.p95 = samples[std::max<size_t>(rank, 1) - 1];
+
+    stats.min = samples.front();
+    stats.max = samples.back();
+
+    return stats;
+}
+
+// prints the stats as the members of a json object, without braces
+inline void printStatsJson(const SampleStats& stats, const char* indent)
+{
+    printf("%s\"samples\": %zu,\n", indent, stats.count);
+    printf("%s\"mean_ms\": %.4f,\n", indent, stats.mean);
+    printf("%s\"median_ms\": %.4f,\n", indent, stats.median);
+    printf("%s\"p95_ms\": %.4f,\n", indent, stats.p95);
+    printf("%s\"min_ms\": %.4f,\n", indent, stats.min);
+    printf("%s\"max_ms\": %.4f", indent, stats.max);
+}
+
+// one member of a bench's "stages" object: the stats of samples in ms and how many
+// units a second that is, with unitsPerSample units done in each sample
+inline void printStageJson(const char* name, const SampleStats& stats, const char* unit, double unitsPerSample, bool last)
+{
+    double unitsPerSecond = stats.mean > 0 ? unitsPerSample / (stats.mean / 1000.0) : 0;
+
+    printf("    \"%s\": {\n", name);
+    printStatsJson(stats, "      ");
+    printf(",\n");
+    printf("      \"%s_per_sec\": %.0f\n", unit, unitsPerSecond);
+    printf("    }%s\n", last ? "" : ",");
+}
+
+// --name value command line flags. A bench adds the flags it takes with their defaults
+// already in place, parse fills them in
+class BenchArgs
+{
+private:
+
+    struct Flag
+    {
+        const char* name;
+        int* number;
+        std::string* text;
+    };
+
+    std::vector<Flag> flags;
+
+public:
+
+    void add(const char* name, int* value)
+    {
+        flags.push_back({ name, value, nullptr });
+    }
+
+    void add(const char* name, std::string* value)
+    {
+        flags.push_back({ name, nullptr, value });
+    }
+
+    // false on an unknown flag, a missing value or a number that doesn't parse whole
+    bool parse(int argc, char** argv)
+    {
+        for(int i = 1; i < argc; i += 2)
+        {
+            if(i + 1 >= argc) return false;
+
+            const Flag* flag = nullptr;
+            for(const Flag& candidate : flags)
+            {
+                if(!strcmp(argv[i], candidate.name)) flag = &candidate;
+            }
+            if(!flag) return false;
+
+            if(flag->text)
+            {
+                *flag->text = argv[i + 1];
+                continue;
+            }
+
+            char* end;
+            errno = 0;
+            long value = strtol(argv[i + 1], &end, 10);
+            if(end == argv[i + 1] || *end || errno || value < INT_MIN || value > INT_MAX) return false;
+            *flag->number = (int)value;
+        }
+
+        return true;
+    }
+
+    void printUsage(const char* program)
+    {
+        fprintf(stderr, "usage: %s", program);
+        for(const Flag& flag : flags)
+        {
+            fprintf(stderr, " [%s %s]", flag.name, flag.text ? "PATH" : "N");
+        }
+        fprintf(stderr, "\n");
+    }
+};
+
+#endif
@@ -0,0 +1,346 @@
+// Compares the terrain collision backends: build time, memory and query cost.
+// The BVH backend is built again through a fresh CollisionCache, once to fill it
+// and once loading every BVH back out of it, and the loaded BVHs have to answer
+// every ray exactly like the built ones. Then streams bodies in and out of one
+// TerrainCollider for a number of rounds, like a player exploring, and checks
+// that nothing is left alive and the free lists stop growing after the first
+// round. Runs headless, no GL context is created. The run exits with status 2
+// when a check fails.
+//
+//  make bench && ./Build/bench/collisionBench [--chunks N] [--queries N] [--rounds N] [--seed N]
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <bullet/btBulletDynamicsCommon.h>
+
+#include "fastnoise/FastNoise.h"
+#include "chunkData.h"
+#include "collisionCache.h"
+#include "terrainCollision.h"
+#include "worldConfig.h"
+
+#include "benchUtils.h"
+
+struct ContactCounter : public btCollisionWorld::ContactResultCallback
+{
+    int contacts = 0;
+
+    btScalar addSingleResult(btManifoldPoint&, const btCollisionObjectWrapper*, int, int,
+                             const btCollisionObjectWrapper*, int, int)
+    {
+        contacts++;
+        return 0;
+    }
+};
+
+//the backends place the same vertices through different transforms, only rounding may differ
+static const float MAX_RAY_HEIGHT_DIFFERENCE = 1e-3f;
+
+struct Query
+{
+    float x;
+    float z;
+    float sphereY;
+};
+
+struct BackendResult
+{
+    TerrainCollisionBackend backend;
+
+    double buildMs;
+    size_t memoryBytes;
+
+    double rayNs;
+    int rayHits;
+    std::vector<float> hitHeights;
+
+    double sphereNs;
+    int sphereContacts;
+};
+
+struct ChurnResult
+{
+    double freshMsPerChunk;
+    double reusedMsPerChunk;
+    size_t pooled;
+    size_t rssGrowthBytes;
+    int errors;
+};
+
+static BackendResult runBackend(TerrainCollisionBackend backend, std::vector<ChunkData*>& chunks, std::vector<Query>& queries,
+                                CollisionCache* cache = nullptr)
+{
+    TerrainCollider collider;
+    collider.setCache(cache);
+
+    BackendResult result;
+    result.backend = backend;
+
+    btDefaultCollisionConfiguration config;
+    btCollisionDispatcher dispatcher(&config);
+    btDbvtBroadphase broadphase;
+    btCollisionWorld world(&dispatcher, &broadphase, &config);
+
+    std::vector<btRigidBody*> bodies;
+
+    Clock::time_point start = Clock::now();
+    for(ChunkData* chunk : chunks)
+    {
+        bodies.push_back(collider.create(chunk, backend));
+    }
+    result.buildMs = elapsedMs(start);
+
+    result.memoryBytes = 0;
+    for(btRigidBody* body : bodies)
+    {
+        result.memoryBytes += TerrainCollider::getMemoryUsage(body);
+        world.addCollisionObject(body);
+    }
+    world.updateAabbs();
+
+    result.rayHits = 0;
+    start = Clock::now();
+    for(const Query& query : queries)
+    {
+        btVector3 from(query.x, chunks[0]->getHeightScale() + 16.f, query.z);
+        btVector3 to(query.x, -16.f, query.z);
+
+        btCollisionWorld::ClosestRayResultCallback callback(from, to);
+        world.rayTest(from, to, callback);
+
+        result.hitHeights.push_back(callback.hasHit() ? callback.m_hitPointWorld.y() : NAN);
+        if(callback.hasHit()) result.rayHits++;
+    }
+    result.rayNs = elapsedMs(start) * 1e6 / queries.size();
+
+    btSphereShape sphere(2.f);
+    btCollisionObject probe;
+    probe.setCollisionShape(&sphere);
+
+    result.sphereContacts = 0;
+    start = Clock::now();
+    for(const Query& query : queries)
+    {
+        btTransform transform;
+        transform.setIdentity();
+        transform.setOrigin(btVector3(query.x, query.sphereY, query.z));
+        probe.setWorldTransform(transform);
+
+        ContactCounter counter;
+        world.contactTest(&probe, counter);
+        result.sphereContacts += counter.contacts;
+    }
+    result.sphereNs = elapsedMs(start) * 1e6 / queries.size();
+
+    for(btRigidBody* body : bodies)
+    {
+        world.removeCollisionObject(body);
+        collider.release(body);
+    }
+
+    return result;
+}
+
+// every round builds half the chunks with each backend, a sliding window so chunks change hands,
+// and releases them all again
+static ChurnResult runChurn(std::vector<ChunkData*>& chunks, int rounds)
+{
+    ChurnResult result;
+    result.errors = 0;
+
+    TerrainCollider collider;
+    std::vector<btRigidBody*> bodies;
+
+    std::vector<double> fresh;
+    std::vector<double> reused;
+    size_t pooledAfterFirst = 0;
+    size_t rssAfterFirst = 0;
+
+    for(int round = 0; round < rounds; ++round)
+    {
+        Clock::time_point start = Clock::now();
+        for(size_t i = 0; i < chunks.size(); ++i)
+        {
+            ChunkData* chunk = chunks[(i + round) % chunks.size()];
+            TerrainCollisionBackend backend = i < chunks.size() / 2 ? TERRAIN_COLLISION_BVH : TERRAIN_COLLISION_HEIGHTFIELD;
+            bodies.push_back(collider.create(chunk, backend));
+        }
+        (round == 0 ? fresh : reused).push_back(elapsedMs(start) / chunks.size());
+
+        if(collider.getNumLive() != chunks.size()) result.errors++;
+
+        for(btRigidBody* body : bodies)
+        {
+            collider.release(body);
+        }
+        bodies.clear();
+
+        if(collider.getNumLive() != 0) result.errors++;
+
+        if(round == 0)
+        {
+            pooledAfterFirst = collider.getNumPooled();
+            rssAfterFirst = getPeakRSSBytes();
+        }
+        else if(collider.getNumPooled() != pooledAfterFirst)
+        {
+            result.errors++;
+        }
+    }
+
+    result.freshMsPerChunk = computeStats(fresh).mean;
+    result.reusedMsPerChunk = computeStats(reused).mean;
+    result.pooled = collider.getNumPooled();
+    result.rssGrowthBytes = getPeakRSSBytes() - rssAfterFirst;
+
+    collider.trim();
+    if(collider.getNumPooled() != 0) result.errors++;
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    int numChunks = 16;
+    int numQueries = 100000;
+    int rounds = 50;
+    int seed = 1337;
+
+    BenchArgs args;
+    args.add("--chunks", &numChunks);
+    args.add("--queries", &numQueries);
+    args.add("--rounds", &rounds);
+    args.add("--seed", &seed);
+    if(!args.parse(argc, argv) || numChunks < 1 || numQueries < 1 || rounds < 1)
+    {
+        args.printUsage(argv[0]);
+        return 1;
+    }
+
+    WorldConfig world;
+    world.seed = seed;
+    FastNoise noise = world.createNoise();
+
+    //square-ish block of chunks around the origin
+    int side = (int)std::ceil(std::sqrt((float)numChunks));
+    std::vector<ChunkData*> chunks;
+    for(int i = 0; i < numChunks; ++i)
+    {
+        chunks.push_back(new ChunkData(world, noise, i % side, i / side));
+    }
+
+    //queries land at random points inside random quads, on either side of the diagonal.
+    //the sphere sits a little above the quad's corner height, close enough to always touch
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> offset(0.1f, 0.9f);
+    std::vector<Query> queries;
+    for(int i = 0; i < numQueries; ++i)
+    {
+        ChunkData* chunk = chunks[rng() % chunks.size()];
+        int gridSize = world.terrainSize + 2;
+        int gridX = rng() % (gridSize - 1);
+        int gridZ = rng() % (gridSize - 1);
+
+        glm::vec3 origin = chunk->getOrigin();
+        float height = chunk->decodeHeight(chunk->getVertexBuffer()[gridX * gridSize + gridZ].height);
+
+        queries.push_back({ origin.x + gridX + offset(rng), origin.z + gridZ + offset(rng), height + 1.f });
+    }
+
+    BackendResult results[2] =
+    {
+        runBackend(TERRAIN_COLLISION_BVH, chunks, queries),
+        runBackend(TERRAIN_COLLISION_HEIGHTFIELD, chunks, queries)
+    };
+
+    //cold stores every BVH, warm loads them all
+    const char* cachePath = "collisionBench.cache";
+    remove(cachePath);
+    CollisionCache* cache = new CollisionCache(cachePath, world);
+    BackendResult cold = runBackend(TERRAIN_COLLISION_BVH, chunks, queries, cache);
+    BackendResult warm = runBackend(TERRAIN_COLLISION_BVH, chunks, queries, cache);
+    size_t cachedChunks = cache->getNumChunks();
+    size_t cacheFileSize = cache->getFileSize();
+    delete cache;
+    remove(cachePath);
+
+    //a loaded BVH is the built one, every ray has to land on the same spot
+    int cacheErrors = cachedChunks == chunks.size() ? 0 : 1;
+    for(int i = 0; i < numQueries; ++i)
+    {
+        float built = results[0].hitHeights[i];
+        float loaded = warm.hitHeights[i];
+        if(built != loaded && !(std::isnan(built) && std::isnan(loaded))) cacheErrors++;
+    }
+
+    ChurnResult churn = runChurn(chunks, rounds < 2 ? 2 : rounds);
+
+    //both split the quads along the same diagonal as the render mesh, the ray hits have to agree
+    float maxDifference = 0.f;
+    int rayMismatches = 0;
+    for(int i = 0; i < numQueries; ++i)
+    {
+        float mesh = results[0].hitHeights[i];
+        float heightfield = results[1].hitHeights[i];
+        if(std::isnan(mesh) || std::isnan(heightfield))
+        {
+            if(std::isnan(mesh) != std::isnan(heightfield)) rayMismatches++;
+            continue;
+        }
+
+        float difference = std::fabs(mesh - heightfield);
+        if(difference > maxDifference) maxDifference = difference;
+        if(difference > MAX_RAY_HEIGHT_DIFFERENCE) rayMismatches++;
+    }
+
+    printf("{\n");
+    printf("  \"chunks\": %d,\n", numChunks);
+    printf("  \"queries\": %d,\n", numQueries);
+    printf("  \"seed\": %d,\n", seed);
+    printf("  \"backends\": [\n");
+    for(int i = 0; i < 2; ++i)
+    {
+        const BackendResult& result = results[i];
+        printf("    {\n");
+        printf("      \"name\": \"%s\",\n", getTerrainCollisionBackendName(result.backend));
+        printf("      \"build_ms\": %.3f,\n", result.buildMs);
+        printf("      \"build_ms_per_chunk\": %.3f,\n", result.buildMs / numChunks);
+        printf("      \"memory_bytes\": %zu,\n", result.memoryBytes);
+        printf("      \"memory_bytes_per_chunk\": %zu,\n", result.memoryBytes / numChunks);
+        printf("      \"ray_ns\": %.1f,\n", result.rayNs);
+        printf("      \"ray_hits\": %d,\n", result.rayHits);
+        printf("      \"sphere_ns\": %.1f,\n", result.sphereNs);
+        printf("      \"sphere_contacts\": %d\n", result.sphereContacts);
+        printf("    }%s\n", i == 0 ? "," : "");
+    }
+    printf("  ],\n");
+    printf("  \"max_ray_height_difference\": %f,\n", maxDifference);
+    printf("  \"ray_mismatches\": %d,\n", rayMismatches);
+    printf("  \"bvh_cache\": {\n");
+    printf("    \"cold_build_ms_per_chunk\": %.3f,\n", cold.buildMs / numChunks);
+    printf("    \"warm_build_ms_per_chunk\": %.3f,\n", warm.buildMs / numChunks);
+    printf("    \"warm_memory_bytes_per_chunk\": %zu,\n", warm.memoryBytes / numChunks);
+    printf("    \"cached_chunks\": %zu,\n", cachedChunks);
+    printf("    \"file_bytes\": %zu,\n", cacheFileSize);
+    printf("    \"errors\": %d\n", cacheErrors);
+    printf("  },\n");
+    printf("  \"churn\": {\n");
+    printf("    \"rounds\": %d,\n", rounds < 2 ? 2 : rounds);
+    printf("    \"fresh_ms_per_chunk\": %.3f,\n", churn.freshMsPerChunk);
+    printf("    \"reused_ms_per_chunk\": %.3f,\n", churn.reusedMsPerChunk);
+    printf("    \"pooled\": %zu,\n", churn.pooled);
+    printf("    \"rss_growth_bytes\": %zu,\n", churn.rssGrowthBytes);
+    printf("    \"errors\": %d\n", churn.errors);
+    printf("  }\n");
+    printf("}\n");
+
+    for(ChunkData* chunk : chunks)
+    {
+        delete chunk;
+    }
+
+    return churn.errors == 0 && cacheErrors == 0 && rayMismatches == 0 ? 0 : 2;
+}
@@ -0,0 +1,248 @@
+// Frustum culling of chunk bounds: the per box Frustum::testIntersection path
+// against ChunkBounds, scalar and SIMD, and ChunkQuadtree over random views of
+// a square world. Also times the quadtree's nearest, radius and column queries against
+// a linear scan. Runs headless, no GL context is created. Every path has to
+// return the same chunks, the run exits with status 2 otherwise.
+//
+//  make bench && ./Build/bench/cullBench [--grid N] [--chunk-size N] [--views N]
+//                                        [--iterations N] [--seed N]
+//
+// --grid N lays out (2N)^2 chunk boxes around the origin
+
+#include <cstdio>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "boundingVolume.h"
+#include "chunkBounds.h"
+#include "chunkQuadtree.h"
+
+#include "benchUtils.h"
+
+struct BenchConfig
+{
+    int grid = 32;
+    int chunkSize = 128;
+    int views = 64;
+    int iterations = 20;
+    int seed = 1337;
+};
+
+static float getDistance2(glm::vec3 pos, const BoundingBox& box)
+{
+    glm::vec3 d = glm::max(glm::max(box.minimum - pos, glm::vec3(0.f)), pos - box.maximum);
+    return glm::dot(d, d);
+}
+
+int main(int argc, char** argv)
+{
+    BenchConfig config;
+    BenchArgs args;
+    args.add("--grid", &config.grid);
+    args.add("--chunk-size", &config.chunkSize);
+    args.add("--views", &config.views);
+    args.add("--iterations", &config.iterations);
+    args.add("--seed", &config.seed);
+    if(!args.parse(argc, argv) ||
+       config.grid < 1 || config.chunkSize < 1 || config.views < 1 || config.iterations < 1)
+    {
+        args.printUsage(argv[0]);
+        return 1;
+    }
+
+    std::mt19937 random(config.seed);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+    //chunk sized boxes with random height ranges, laid out like ChunkData's world bounds
+    std::vector<BoundingBox> boxes;
+    ChunkBounds bounds;
+    ChunkQuadtree<uint32_t> quadtree;
+    float stride = config.chunkSize + 1;
+    for(int x = -config.grid; x < config.grid; ++x)
+    {
+        for(int z = -config.grid; z < config.grid; ++z)
+        {
+            float low = unit(random) * 128.f;
+            float high = low + unit(random) * 128.f;
+
+            glm::vec3 min(-1.f + x * stride, low, -1.f + z * stride);
+            glm::vec3 max = min + glm::vec3(stride, 0.f, stride);
+            max.y = high;
+
+            quadtree.insert(boxes.size(), x, z, min, max);
+            boxes.push_back(BoundingBox(min, max));
+            bounds.add(min, max);
+        }
+    }
+
+    //cameras somewhere over the world looking in random directions, same projection as the game
+    glm::mat4 proj = glm::perspective(45.f, 1280.f/720.f, 4.f, 1024.f);
+    float extent = config.grid * stride;
+
+    std::vector<Frustum> frustums;
+    std::vector<glm::vec3> eyes;
+    for(int v = 0; v < config.views; ++v)
+    {
+        glm::vec3 eye((unit(random) * 2.f - 1.f) * extent, 64.f + unit(random) * 256.f, (unit(random) * 2.f - 1.f) * extent);
+
+        float yaw = unit(random) * 6.2831853f;
+        float pitch = (unit(random) - 0.75f) * 1.5f;
+        glm::vec3 dir(std::cos(yaw) * std::cos(pitch), std::sin(pitch), std::sin(yaw) * std::cos(pitch));
+
+        eyes.push_back(eye);
+        frustums.push_back(Frustum(glm::lookAt(eye, eye + dir, glm::vec3(0.f, 1.f, 0.f)), proj));
+    }
+
+    std::vector<uint32_t> expected;
+    std::vector<uint32_t> visible;
+    int mismatches = 0;
+    size_t totalVisible = 0;
+
+    //one sample per view
+    std::vector<double> frustumSamples;
+    std::vector<double> scalarSamples;
+    std::vector<double> simdSamples;
+    std::vector<double> quadtreeSamples;
+    for(int iteration = 0; iteration < config.iterations; ++iteration)
+    {
+        for(const Frustum& frustum : frustums)
+        {
+            Clock::time_point start = Clock::now();
+            expected.clear();
+            for(size_t i = 0; i < boxes.size(); ++i)
+            {
+                if(frustum.testIntersection(boxes[i]) != BoundingVolume::TEST_OUTSIDE)
+                {
+                    expected.push_back(i);
+                }
+            }
+            frustumSamples.push_back(elapsedMs(start));
+
+            start = Clock::now();
+            bounds.cullScalar(frustum.getPlanes(), 0.f, visible);
+            scalarSamples.push_back(elapsedMs(start));
+
+            if(visible != expected) mismatches++;
+
+            start = Clock::now();
+            bounds.cull(frustum.getPlanes(), 0.f, visible);
+            simdSamples.push_back(elapsedMs(start));
+
+            if(visible != expected) mismatches++;
+
+            start = Clock::now();
+            quadtree.cull(frustum.getPlanes(), 0.f, visible);
+            quadtreeSamples.push_back(elapsedMs(start));
+
+            //the tree lists chunks in tree order
+            std::sort(visible.begin(), visible.end());
+            if(visible != expected) mismatches++;
+            if(iteration == 0) totalVisible += expected.size();
+        }
+    }
+
+    //nearest chunk and chunks within QUERY_RADIUS of each camera, like physics and streaming ask for
+    const float QUERY_RADIUS = 256.f;
+
+    std::vector<double> nearestScanSamples;
+    std::vector<double> nearestSamples;
+    std::vector<double> radiusScanSamples;
+    std::vector<double> radiusSamples;
+    std::vector<double> columnSamples;
+    for(int iteration = 0; iteration < config.iterations; ++iteration)
+    {
+        for(glm::vec3 eye : eyes)
+        {
+            Clock::time_point start = Clock::now();
+            float best = 1e30f;
+            for(const BoundingBox& box : boxes)
+            {
+                best = std::min(best, getDistance2(eye, box));
+            }
+            nearestScanSamples.push_back(elapsedMs(start));
+
+            start = Clock::now();
+            uint32_t nearest = 0;
+            bool found = quadtree.findNearest(eye, nearest);
+            nearestSamples.push_back(elapsedMs(start));
+
+            //ties can go either way, compare the distance
+            if(!found || getDistance2(eye, boxes[nearest]) != best) mismatches++;
+
+            start = Clock::now();
+            expected.clear();
+            for(size_t i = 0; i < boxes.size(); ++i)
+            {
+                if(getDistance2(eye, boxes[i]) <= QUERY_RADIUS * QUERY_RADIUS) expected.push_back(i);
+            }
+            radiusScanSamples.push_back(elapsedMs(start));
+
+            start = Clock::now();
+            quadtree.findInRadius(eye, QUERY_RADIUS, visible);
+            radiusSamples.push_back(elapsedMs(start));
+
+            std::sort(visible.begin(), visible.end());
+            if(visible != expected) mismatches++;
+
+            //the eye is usually far above the boxes, the column query ignores that
+            expected.clear();
+            for(size_t i = 0; i < boxes.size(); ++i)
+            {
+                glm::vec3 column(eye.x, glm::clamp(eye.y, boxes[i].minimum.y, boxes[i].maximum.y), eye.z);
+                if(getDistance2(column, boxes[i]) <= QUERY_RADIUS * QUERY_RADIUS) expected.push_back(i);
+            }
+
+            start = Clock::now();
+            visible.clear();
+            quadtree.findInColumn(eye, QUERY_RADIUS, visible);
+            columnSamples.push_back(elapsedMs(start));
+
+            std::sort(visible.begin(), visible.end());
+            if(visible != expected) mismatches++;
+        }
+    }
+
+    //removing everything has to leave an empty tree behind
+    for(int x = -config.grid; x < config.grid; ++x)
+    {
+        for(int z = -config.grid; z < config.grid; ++z)
+        {
+            if(!quadtree.remove(x, z)) mismatches++;
+        }
+    }
+    uint32_t nearest;
+    if(quadtree.size() != 0 || quadtree.findNearest(glm::vec3(0.f), nearest)) mismatches++;
+
+    double numBoxes = boxes.size();
+
+    printf("{\n");
+    printf("  \"config\": {\n");
+    printf("    \"grid\": %d,\n", config.grid);
+    printf("    \"boxes\": %zu,\n", boxes.size());
+    printf("    \"chunk_size\": %d,\n", config.chunkSize);
+    printf("    \"views\": %d,\n", config.views);
+    printf("    \"iterations\": %d,\n", config.iterations);
+    printf("    \"seed\": %d\n", config.seed);
+    printf("  },\n");
+    printf("  \"instruction_set\": \"%s\",\n", ChunkBounds::getInstructionSet());
+    printf("  \"visible_per_view\": %zu,\n", totalVisible / config.views);
+    printf("  \"mismatches\": %d,\n", mismatches);
+    printf("  \"stages\": {\n");
+    printStageJson("frustum_per_box", computeStats(frustumSamples), "boxes", numBoxes, false);
+    printStageJson("chunk_bounds_scalar", computeStats(scalarSamples), "boxes", numBoxes, false);
+    printStageJson("chunk_bounds", computeStats(simdSamples), "boxes", numBoxes, false);
+    printStageJson("quadtree", computeStats(quadtreeSamples), "boxes", numBoxes, false);
+    printStageJson("nearest_scan", computeStats(nearestScanSamples), "boxes", numBoxes, false);
+    printStageJson("quadtree_nearest", computeStats(nearestSamples), "boxes", numBoxes, false);
+    printStageJson("radius_scan", computeStats(radiusScanSamples), "boxes", numBoxes, false);
+    printStageJson("quadtree_radius", computeStats(radiusSamples), "boxes", numBoxes, false);
+    printStageJson("quadtree_column", computeStats(columnSamples), "boxes", numBoxes, true);
+    printf("  }\n");
+    printf("}\n");
+
+    return mismatches == 0 ? 0 : 2;
+}
@@ -0,0 +1,202 @@
+// Checks FastNoise's batched grid functions against the single point ones on
+// every instruction set this build and CPU can run, forced one at a time with
+// FastNoise::SetGridInstructionSet: value, Perlin and simplex noise, each with
+// linear, Hermite and quintic interpolation, over several seeds, frequencies,
+// steps and row lengths that leave a partial vector at the end. The grids have
+// to be bit-identical. Also times a chunk sized value grid per instruction set.
+// The run exits with status 2 when a check fails.
+//
+//  make bench && ./Build/bench/noiseGridBench [--grid N] [--iterations N]
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "fastnoise/FastNoise.h"
+
+#include "benchUtils.h"
+
+enum NoiseType { NOISE_VALUE, NOISE_PERLIN, NOISE_SIMPLEX };
+
+static const char* NOISE_NAMES[] = { "value", "perlin", "simplex" };
+static const char* INSTRUCTION_SETS[] = { "scalar", "SSE2", "AVX2" };
+
+struct GridCase
+{
+    FN_DECIMAL xStart;
+    FN_DECIMAL yStart;
+    FN_DECIMAL step;
+    int xCount;
+    int yCount;
+};
+
+//row lengths below, at and past a vector, and starts on both sides of zero
+static const GridCase GRID_CASES[] =
+{
+    { 0.f, 0.f, 1.f, 3, 1 },
+    { -1.f, -1.f, 0.25f, 5, 7 },
+    { 13.5f, -200.25f, 0.5f, 4, 8 },
+    { -513.f, 37.f, 1.f, 3, 37 },
+    { 1000.f, 1000.f, 0.1f, 2, 131 }
+};
+
+static const int SEEDS[] = { 1337, 0, -42 };
+static const FN_DECIMAL FREQUENCIES[] = { 0.01f, 0.5f, 1.f };
+
+static FN_DECIMAL getPoint(const FastNoise& noise, NoiseType type, FN_DECIMAL x, FN_DECIMAL y)
+{
+    switch(type)
+    {
+        case NOISE_VALUE:
+            return noise.GetValue(x, y);
+        case NOISE_PERLIN:
+            return noise.GetPerlin(x, y);
+        default:
+            return noise.GetSimplex(x, y);
+    }
+}
+
+static void getGrid(const FastNoise& noise, NoiseType type, FN_DECIMAL* out, const GridCase& grid)
+{
+    switch(type)
+    {
+        case NOISE_VALUE:
+            noise.GetValueGrid(out, grid.xStart, grid.yStart, grid.step, grid.xCount, grid.yCount);
+            break;
+        case NOISE_PERLIN:
+            noise.GetPerlinGrid(out, grid.xStart, grid.yStart, grid.step, grid.xCount, grid.yCount);
+            break;
+        default:
+            noise.GetSimplexGrid(out, grid.xStart, grid.yStart, grid.step, grid.xCount, grid.yCount);
+            break;
+    }
+}
+
+// points of every combination that differ from the single point function
+static int checkNoise(NoiseType type, double& maxError)
+{
+    int mismatches = 0;
+    std::vector<FN_DECIMAL> out;
+
+    for(int seed : SEEDS)
+    {
+        for(FN_DECIMAL frequency : FREQUENCIES)
+        {
+            for(int interp = FastNoise::Linear; interp <= FastNoise::Quintic; ++interp)
+            {
+                FastNoise noise(seed);
+                noise.SetFrequency(frequency);
+                noise.SetInterp((FastNoise::Interp)interp);
+
+                for(const GridCase& grid : GRID_CASES)
+                {
+                    out.assign(grid.xCount * grid.yCount, NAN);
+                    getGrid(noise, type, out.data(), grid);
+
+                    for(int xi = 0; xi < grid.xCount; ++xi)
+                    {
+                        for(int yi = 0; yi < grid.yCount; ++yi)
+                        {
+                            FN_DECIMAL expected = getPoint(noise, type, grid.xStart + (FN_DECIMAL)xi * grid.step,
+                                                                        grid.yStart + (FN_DECIMAL)yi * grid.step);
+                            FN_DECIMAL actual = out[xi * grid.yCount + yi];
+                            if(actual == expected) continue;
+
+                            mismatches++;
+                            //NaN means the lane was never written
+                            double error = std::isnan(actual) ? 1e30 : std::fabs((double)actual - (double)expected);
+                            if(error > maxError) maxError = error;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return mismatches;
+}
+
+// nanoseconds per point of a gridSize^2 value grid, the shape terrain generation asks for
+static std::vector<double> timeValueGrid(int gridSize, int iterations)
+{
+    FastNoise noise;
+    std::vector<FN_DECIMAL> out(gridSize * gridSize);
+
+    std::vector<double> samples;
+    for(int i = 0; i < iterations; ++i)
+    {
+        Clock::time_point start = Clock::now();
+        noise.GetValueGrid(out.data(), -1.f + i, 1.f, 0.25f, gridSize, gridSize);
+        samples.push_back(elapsedMs(start) * 1e6 / ((double)gridSize * gridSize));
+    }
+
+    return samples;
+}
+
+int main(int argc, char** argv)
+{
+    int gridSize = 131;
+    int iterations = 200;
+
+    BenchArgs args;
+    args.add("--grid", &gridSize);
+    args.add("--iterations", &iterations);
+    if(!args.parse(argc, argv) || gridSize < 1 || iterations < 1)
+    {
+        args.printUsage(argv[0]);
+        return 1;
+    }
+
+    const char* detected = FastNoise::GetGridInstructionSet();
+    int errors = 0;
+
+    printf("{\n");
+    printf("  \"detected\": \"%s\",\n", detected);
+    printf("  \"grid\": %d,\n", gridSize);
+    printf("  \"instruction_sets\": {\n");
+
+    int numSets = sizeof(INSTRUCTION_SETS) / sizeof(INSTRUCTION_SETS[0]);
+    for(int s = 0; s < numSets; ++s)
+    {
+        const char* name = INSTRUCTION_SETS[s];
+        printf("    \"%s\": {\n", name);
+
+        if(!FastNoise::SetGridInstructionSet(name))
+        {
+            //every build can run the scalar path
+            if(!strcmp(name, "scalar")) errors++;
+
+            printf("      \"supported\": false\n");
+            printf("    }%s\n", s + 1 < numSets ? "," : "");
+            continue;
+        }
+
+        if(strcmp(FastNoise::GetGridInstructionSet(), name)) errors++;
+
+        printf("      \"supported\": true,\n");
+        for(int type = NOISE_VALUE; type <= NOISE_SIMPLEX; ++type)
+        {
+            double maxError = 0.0;
+            int mismatches = checkNoise((NoiseType)type, maxError);
+            errors += mismatches;
+
+            printf("      \"%s_mismatches\": %d,\n", NOISE_NAMES[type], mismatches);
+            printf("      \"%s_max_error\": %g,\n", NOISE_NAMES[type], maxError);
+        }
+
+        SampleStats stats = computeStats(timeValueGrid(gridSize, iterations));
+        printf("      \"value_grid_ns_per_point_median\": %.2f,\n", stats.median);
+        printf("      \"value_grid_ns_per_point_min\": %.2f\n", stats.min);
+        printf("    }%s\n", s + 1 < numSets ? "," : "");
+    }
+
+    FastNoise::SetGridInstructionSet(nullptr);
+    if(strcmp(FastNoise::GetGridInstructionSet(), detected)) errors++;
+
+    printf("  },\n");
+    printf("  \"errors\": %d\n", errors);
+    printf("}\n");
+
+    return errors == 0 ? 0 : 2;
+}
@@ -0,0 +1,176 @@
+// Cost of the Profiler's CPU zones: an empty PROFILE_SCOPE timed in a tight
+// loop on one thread and on several at once, against the same loop with the
+// profiler disabled, and the frame overhead that works out to at a given number
+// of zones per frame. The threaded run also reads the ring while it is being
+// written, every record read back has to be whole and from the thread it names,
+// and the Chrome trace has to be written. Runs headless, GPU zones aren't
+// covered. The run exits with status 2 when a check fails.
+//
+//  make bench && ./Build/bench/profilerBench [--zones N] [--threads N]
+//                                            [--zones-per-frame N] [--iterations N]
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "profiler.h"
+
+#include "benchUtils.h"
+
+struct BenchConfig
+{
+    int zones = 1 << 20;
+    int threads = 4;
+    int zonesPerFrame = 200;
+    int iterations = 10;
+};
+
+//one name per thread so the reader can tell whose record it got
+static const char* THREAD_NAMES[] = { "zone 0", "zone 1", "zone 2", "zone 3", "zone 4", "zone 5", "zone 6", "zone 7" };
+static const int MAX_THREADS = sizeof(THREAD_NAMES) / sizeof(THREAD_NAMES[0]);
+
+static void recordZones(int count, const char* name)
+{
+    for(int i = 0; i < count; ++i)
+    {
+        PROFILE_SCOPE(name);
+    }
+}
+
+// ms for every thread to record its zones, runs the threads in parallel
+static double timeZones(int zones, int threads)
+{
+    Clock::time_point start = Clock::now();
+
+    std::vector<std::thread> workers;
+    for(int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back(recordZones, zones, THREAD_NAMES[t]);
+    }
+    for(std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    return elapsedMs(start);
+}
+
+int main(int argc, char** argv)
+{
+    BenchConfig config;
+    BenchArgs args;
+    args.add("--zones", &config.zones);
+    args.add("--threads", &config.threads);
+    args.add("--zones-per-frame", &config.zonesPerFrame);
+    args.add("--iterations", &config.iterations);
+    if(!args.parse(argc, argv) ||
+       config.zones < 1 || config.threads < 1 || config.zonesPerFrame < 0 || config.iterations < 1)
+    {
+        args.printUsage(argv[0]);
+        return 1;
+    }
+    if(config.threads > MAX_THREADS) config.threads = MAX_THREADS;
+
+    Profiler& profiler = Profiler::get();
+    profiler.setThreadName("bench");
+
+    std::vector<double> disabled;
+    std::vector<double> single;
+    std::vector<double> threaded;
+
+    for(int i = 0; i < config.iterations; ++i)
+    {
+        profiler.setEnabled(false);
+        disabled.push_back(timeZones(config.zones, 1));
+
+        profiler.setEnabled(true);
+        single.push_back(timeZones(config.zones, 1));
+        threaded.push_back(timeZones(config.zones, config.threads));
+    }
+
+    //read the ring while the threads fill it, like the overlay does every frame
+    int errors = 0;
+    size_t recordsRead = 0;
+    {
+        std::atomic<bool> writing(true);
+        std::thread writer([&]()
+        {
+            timeZones(config.zones, config.threads);
+            writing = false;
+        });
+
+        std::vector<ProfileRecord> records;
+        uint64_t index = profiler.getWriteIndex();
+        bool done = false;
+        while(!done)
+        {
+            done = !writing;
+
+            records.clear();
+            index = profiler.readRecords(index, records);
+            recordsRead += records.size();
+
+            for(const ProfileRecord& record : records)
+            {
+                if(record.thread == Profiler::GPU_THREAD || record.gpu) errors++;
+                else if(record.end < record.start) errors++;
+                else if(strncmp(record.name, "zone ", 5)) errors++;
+            }
+        }
+        writer.join();
+    }
+
+    //the last CAPACITY zones all came from the run above, where every name belongs to one thread
+    if((uint64_t)config.zones * config.threads >= Profiler::CAPACITY)
+    {
+        std::vector<ProfileRecord> records;
+        uint64_t to = profiler.getWriteIndex();
+        profiler.readRecords(to - Profiler::CAPACITY, records);
+        //a writer preempted for a whole lap of the ring can land on a newer zone's slot, which is then
+        //skipped. One per thread at most
+        if(records.size() + config.threads < Profiler::CAPACITY) errors++;
+
+        std::vector<uint32_t> threadIds(MAX_THREADS, Profiler::GPU_THREAD);
+        for(const ProfileRecord& record : records)
+        {
+            uint32_t& id = threadIds[record.name[5] - '0'];
+            if(id == Profiler::GPU_THREAD) id = record.thread;
+            else if(id != record.thread) errors++;
+        }
+    }
+
+    std::string tracePath = "profilerBench.json";
+    Clock::time_point traceStart = Clock::now();
+    if(!profiler.writeChromeTrace(tracePath)) errors++;
+    double traceMs = elapsedMs(traceStart);
+    remove(tracePath.c_str());
+
+    double zoneNs = computeStats(single).median * 1e6 / config.zones;
+    double frameMs = 1000.0 / 60.0;
+    double frameOverhead = zoneNs * config.zonesPerFrame / 1e6 / frameMs;
+
+    printf("{\n");
+    printf("  \"config\": {\n");
+    printf("    \"zones\": %d,\n", config.zones);
+    printf("    \"threads\": %d,\n", config.threads);
+    printf("    \"zones_per_frame\": %d,\n", config.zonesPerFrame);
+    printf("    \"iterations\": %d,\n", config.iterations);
+    printf("    \"capacity\": %zu\n", Profiler::CAPACITY);
+    printf("  },\n");
+    printf("  \"stages\": {\n");
+    printStageJson("disabled", computeStats(disabled), "zones", config.zones, false);
+    printStageJson("single_thread", computeStats(single), "zones", config.zones, false);
+    printStageJson("threaded", computeStats(threaded), "zones", (double)config.zones * config.threads, true);
+    printf("  },\n");
+    printf("  \"ns_per_zone\": %.2f,\n", zoneNs);
+    printf("  \"frame_overhead_percent\": %.4f,\n", frameOverhead * 100.0);
+    printf("  \"concurrent_records_read\": %zu,\n", recordsRead);
+    printf("  \"trace_write_ms\": %.2f,\n", traceMs);
+    printf("  \"errors\": %d\n", errors);
+    printf("}\n");
+
+    return errors == 0 ? 0 : 2;
+}
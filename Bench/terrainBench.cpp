@@ -0,0 +1,365 @@
+// Headless terrain generation benchmark, no SDL window or GL context.
+// Times single chunk generation, generateChunkData on a thread pool, loading the
+// same chunks back from a ChunkCache and collision shape creation for both
+// backends, and prints the results as JSON. Also checks that the same WorldConfig
+// generates bit-identical chunks on one thread and on --threads threads.
+//
+//  make bench && ./Build/bench/terrainBench [--grid N] [--chunk-size N] [--threads N]
+//                                           [--seed N] [--iterations N] [--warmup N]
+//                                           [--cache PATH]
+//
+// --grid N generates the (2N)^2 chunks around the origin, like generateChunkData(N)
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fastnoise/FastNoise.h"
+#include "chunkCache.h"
+#include "chunkData.h"
+#include "grassField.h"
+#include "terrainChunkGenerator.h"
+#include "terrainCollision.h"
+#include "threadPool.h"
+#include "worldConfig.h"
+
+#include "benchUtils.h"
+
+struct BenchConfig
+{
+    int grid = 2;
+    int chunkSize = 128;
+    int threads = std::thread::hardware_concurrency();
+    int seed = 1337;
+    int iterations = 5;
+    int warmup = 1;
+    //recreated on every run and removed afterwards
+    std::string cachePath = "terrainBench.cache";
+};
+
+static bool isValid(const BenchConfig& config)
+{
+    //the packed vertex stores grid positions in 8 bits
+    if(config.chunkSize < 2 || config.chunkSize > 254) return false;
+    return config.grid >= 1 && config.iterations >= 1 && config.warmup >= 0;
+}
+
+static void deleteChunks(std::vector<ChunkData*>& chunks)
+{
+    for(ChunkData* chunk : chunks)
+    {
+        delete chunk;
+    }
+    chunks.clear();
+}
+
+// FNV-1a over every chunk's vertices in generation order
+static uint64_t hashChunks(const std::vector<ChunkData*>& chunks)
+{
+    uint64_t h = 14695981039346656037ull;
+    for(ChunkData* chunk : chunks)
+    {
+        const unsigned char* bytes = (const unsigned char*)chunk->getVertexBuffer();
+        for(size_t i = 0; i < chunk->getNumVertices() * sizeof(TerrainVertex); ++i)
+        {
+            h ^= bytes[i];
+            h *= 1099511628211ull;
+        }
+    }
+    return h;
+}
+
+static bool isInside(glm::vec3 p, glm::vec3 min, glm::vec3 max)
+{
+    return p.x >= min.x && p.y >= min.y && p.z >= min.z &&
+           p.x <= max.x && p.y <= max.y && p.z <= max.z;
+}
+
+// the batched noise used by generation has to match the scalar path
+static float checkNoiseGrid(const BenchConfig& config, const WorldConfig& world)
+{
+    FastNoise noise = world.createNoise();
+
+    int gridSize = config.chunkSize + 3;
+    std::vector<float> batch(gridSize * gridSize);
+
+    float maxError = 0.f;
+    for(int chunk = -config.grid; chunk < config.grid; ++chunk)
+    {
+        float origin = -1.f + chunk * (config.chunkSize + 1);
+        noise.GetValueGrid(batch.data(), origin, -origin, 0.25f, gridSize, gridSize);
+
+        for(int i = 0; i < gridSize; ++i)
+        {
+            for(int j = 0; j < gridSize; ++j)
+            {
+                float scalar = noise.GetValue(origin + i * 0.25f, -origin + j * 0.25f);
+                maxError = std::max(maxError, std::fabs(scalar - batch[i * gridSize + j]));
+            }
+        }
+    }
+
+    return maxError;
+}
+
+int main(int argc, char** argv)
+{
+    BenchConfig config;
+    BenchArgs args;
+    args.add("--grid", &config.grid);
+    args.add("--chunk-size", &config.chunkSize);
+    args.add("--threads", &config.threads);
+    args.add("--seed", &config.seed);
+    args.add("--iterations", &config.iterations);
+    args.add("--warmup", &config.warmup);
+    args.add("--cache", &config.cachePath);
+    if(!args.parse(argc, argv) || !isValid(config))
+    {
+        args.printUsage(argv[0]);
+        return 1;
+    }
+    if(config.threads < 1) config.threads = 1;
+
+    WorldConfig world;
+    world.seed = config.seed;
+    world.terrainSize = config.chunkSize;
+
+    FastNoise noise = world.createNoise();
+
+    ThreadPool pool(config.threads);
+
+    int numChunks = 4 * config.grid * config.grid;
+    double verticesPerChunk = (config.chunkSize + 2) * (config.chunkSize + 2);
+
+    float noiseError = checkNoiseGrid(config, world);
+
+    //single chunks on this thread, one sample per chunk
+    std::vector<double> chunkSamples;
+    for(int iteration = 0; iteration < config.warmup + config.iterations; ++iteration)
+    {
+        for(int x = -config.grid; x < config.grid; ++x)
+        {
+            for(int z = -config.grid; z < config.grid; ++z)
+            {
+                Clock::time_point start = Clock::now();
+                ChunkData* chunk = new ChunkData(world, noise, x, z);
+                double ms = elapsedMs(start);
+
+                delete chunk;
+                if(iteration >= config.warmup) chunkSamples.push_back(ms);
+            }
+        }
+    }
+    SampleStats chunkStats = computeStats(chunkSamples);
+
+    //whole generateChunkData calls, one sample per call
+    std::vector<double> generateSamples;
+    std::vector<ChunkData*> chunks;
+    for(int iteration = 0; iteration < config.warmup + config.iterations; ++iteration)
+    {
+        deleteChunks(chunks);
+
+        Clock::time_point start = Clock::now();
+        chunks = generateChunkData(config.grid, world, pool);
+        double ms = elapsedMs(start);
+
+        if(iteration >= config.warmup) generateSamples.push_back(ms);
+    }
+    SampleStats generateStats = computeStats(generateSamples);
+
+    //the same config on a single thread has to give the same bytes
+    uint64_t worldHash = hashChunks(chunks);
+    ThreadPool singlePool(1);
+    std::vector<ChunkData*> singleChunks = generateChunkData(config.grid, world, singlePool);
+    uint64_t singleHash = hashChunks(singleChunks);
+    deleteChunks(singleChunks);
+
+    //store the last generated set, then reopen the file and load it back like a later run would
+    remove(config.cachePath.c_str());
+    ChunkCache* cache = new ChunkCache(config.cachePath, world);
+    for(ChunkData* chunk : chunks)
+    {
+        cache->store(chunk);
+    }
+    delete cache;
+
+    cache = new ChunkCache(config.cachePath, world);
+    size_t cacheChunks = cache->getNumChunks();
+    size_t cacheFileSize = cache->getFileSize();
+
+    std::vector<double> cacheSamples;
+    int cacheMismatches = 0;
+    for(int iteration = 0; iteration < config.warmup + config.iterations; ++iteration)
+    {
+        for(ChunkData* chunk : chunks)
+        {
+            Clock::time_point start = Clock::now();
+            ChunkData* cached = cache->load(chunk->getChunkX(), chunk->getChunkZ());
+            double ms = elapsedMs(start);
+
+            if(!cached || memcmp(cached->getVertexBuffer(), chunk->getVertexBuffer(), 
+                                 chunk->getNumVertices() * sizeof(TerrainVertex)) != 0)
+            {
+                cacheMismatches++;
+            }
+
+            delete cached;
+            if(iteration >= config.warmup) cacheSamples.push_back(ms);
+        }
+    }
+    SampleStats cacheStats = computeStats(cacheSamples);
+
+    delete cache;
+    remove(config.cachePath.c_str());
+
+    //every vertex has to be inside its chunk's and tile's bounds. Also how much of the
+    //height range the bounds span, on average, compared to the old 0 to heightScale
+    int boundsErrors = 0;
+    double chunkRange = 0.0;
+    double tileRange = 0.0;
+    size_t numTiles = 0;
+    for(ChunkData* chunk : chunks)
+    {
+        int gridSize = chunk->getTerrainSize() + 2;
+        int tilesPerSide = ChunkData::getNumTiles(chunk->getTerrainSize());
+        const ChunkBounds& tiles = chunk->getTileBounds();
+
+        std::vector<float> positions(3 * chunk->getNumVertices());
+        chunk->decodePositions(positions.data());
+
+        for(int i = 0; i < gridSize; ++i)
+        {
+            for(int j = 0; j < gridSize; ++j)
+            {
+                const float* p = &positions[3 * (i * gridSize + j)];
+                glm::vec3 position(p[0], p[1], p[2]);
+
+                //vertices on a tile edge only have to be inside one of the tiles
+                size_t tile = std::min(i / ChunkData::TILE_SIZE, tilesPerSide - 1) * tilesPerSide +
+                              std::min(j / ChunkData::TILE_SIZE, tilesPerSide - 1);
+
+                if(!isInside(position, chunk->getWorldMin(), chunk->getWorldMax()) ||
+                   !isInside(position, tiles.getMin(tile), tiles.getMax(tile)))
+                {
+                    boundsErrors++;
+                }
+            }
+        }
+
+        chunkRange += (chunk->getWorldMax().y - chunk->getWorldMin().y) / chunk->getHeightScale();
+        for(size_t t = 0; t < tiles.size(); ++t)
+        {
+            tileRange += (tiles.getMax(t).y - tiles.getMin(t).y) / chunk->getHeightScale();
+        }
+        numTiles += tiles.size();
+    }
+
+    //grass of the last generated set, one sample per chunk
+    std::vector<double> grassSamples;
+    size_t grassBlades = 0;
+    for(int iteration = 0; iteration < config.warmup + config.iterations; ++iteration)
+    {
+        for(ChunkData* chunk : chunks)
+        {
+            Clock::time_point start = Clock::now();
+            chunk->scatterGrass(world.grass);
+            double ms = elapsedMs(start);
+
+            if(iteration >= config.warmup) grassSamples.push_back(ms);
+            if(iteration == 0) grassBlades += chunk->getGrass()->getNumBlades();
+        }
+    }
+    SampleStats grassStats = computeStats(grassSamples);
+
+    //collision shapes for the last generated set, one sample per chunk. After the first
+    //chunk every build reuses the previous one's allocations, like streaming does
+    TerrainCollider collider;
+    TerrainCollisionBackend backends[2] = { TERRAIN_COLLISION_BVH, TERRAIN_COLLISION_HEIGHTFIELD };
+    SampleStats collisionStats[2];
+    size_t collisionMemory[2];
+    for(int b = 0; b < 2; ++b)
+    {
+        std::vector<double> samples;
+        collisionMemory[b] = 0;
+
+        for(int iteration = 0; iteration < config.warmup + config.iterations; ++iteration)
+        {
+            for(ChunkData* chunk : chunks)
+            {
+                Clock::time_point start = Clock::now();
+                btRigidBody* body = collider.create(chunk, backends[b]);
+                double ms = elapsedMs(start);
+
+                if(iteration >= config.warmup) samples.push_back(ms);
+                if(iteration == 0) collisionMemory[b] += TerrainCollider::getMemoryUsage(body);
+
+                collider.release(body);
+            }
+        }
+
+        collisionStats[b] = computeStats(samples);
+    }
+
+    printf("{\n");
+    printf("  \"config\": {\n");
+    printf("    \"grid\": %d,\n", config.grid);
+    printf("    \"chunks\": %d,\n", numChunks);
+    printf("    \"chunk_size\": %d,\n", config.chunkSize);
+    printf("    \"vertices_per_chunk\": %.0f,\n", verticesPerChunk);
+    printf("    \"threads\": %d,\n", config.threads);
+    printf("    \"seed\": %d,\n", config.seed);
+    printf("    \"iterations\": %d,\n", config.iterations);
+    printf("    \"warmup\": %d\n", config.warmup);
+    printf("  },\n");
+    printf("  \"noise_grid\": {\n");
+    printf("    \"instruction_set\": \"%s\",\n", FastNoise::GetGridInstructionSet());
+    printf("    \"max_abs_error\": %g\n", noiseError);
+    printf("  },\n");
+    printf("  \"determinism\": {\n");
+    printf("    \"world_hash\": \"%016llx\",\n", (unsigned long long)worldHash);
+    printf("    \"single_thread_hash\": \"%016llx\",\n", (unsigned long long)singleHash);
+    printf("    \"match\": %s\n", worldHash == singleHash ? "true" : "false");
+    printf("  },\n");
+    printf("  \"chunk_cache\": {\n");
+    printf("    \"chunks\": %zu,\n", cacheChunks);
+    printf("    \"file_bytes\": %zu,\n", cacheFileSize);
+    printf("    \"mismatches\": %d\n", cacheMismatches);
+    printf("  },\n");
+    printf("  \"bounds\": {\n");
+    printf("    \"chunk_height_fraction\": %.3f,\n", chunkRange / numChunks);
+    printf("    \"tile_height_fraction\": %.3f,\n", tileRange / numTiles);
+    printf("    \"errors\": %d\n", boundsErrors);
+    printf("  },\n");
+    printf("  \"grass\": {\n");
+    printf("    \"blades_per_chunk\": %zu,\n", grassBlades / numChunks);
+    printf("    \"bytes_per_chunk\": %zu\n", grassBlades * sizeof(GrassBlade) / numChunks);
+    printf("  },\n");
+    printf("  \"stages\": {\n");
+    printStageJson("chunk", chunkStats, "vertices", verticesPerChunk, false);
+    printStageJson("generate_chunks", generateStats, "vertices", verticesPerChunk * numChunks, false);
+    printStageJson("cache_load", cacheStats, "vertices", verticesPerChunk, false);
+    printStageJson("grass_scatter", grassStats, "vertices", verticesPerChunk, false);
+    for(int b = 0; b < 2; ++b)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "collision_%s", getTerrainCollisionBackendName(backends[b]));
+        printStageJson(name, collisionStats[b], "vertices", verticesPerChunk, b == 1);
+    }
+    printf("  },\n");
+    printf("  \"collision_memory_bytes_per_chunk\": {\n");
+    printf("    \"%s\": %zu,\n", getTerrainCollisionBackendName(backends[0]), collisionMemory[0] / numChunks);
+    printf("    \"%s\": %zu\n", getTerrainCollisionBackendName(backends[1]), collisionMemory[1] / numChunks);
+    printf("  },\n");
+    //the process's high water mark, the stages run one after another and share it
+    printf("  \"peak_rss_bytes\": %zu\n", getPeakRSSBytes());
+    printf("}\n");
+
+    deleteChunks(chunks);
+
+    //a failed noise, determinism, cache or bounds check fails the run so scripts notice
+    return noiseError == 0.f && worldHash == singleHash && cacheMismatches == 0 && boundsErrors == 0 ? 0 : 2;
+}
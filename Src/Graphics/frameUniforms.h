@@ -0,0 +1,69 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include "glad/glad.h"
+#include <glm/glm.hpp>
+
+#include "shader.h"
+
+// Camera and light state shared by every shader that declares the FrameUniforms
+// block. Renderer fills it in once per frame, the shaders read it from a uniform
+// buffer instead of each renderer setting the same uniforms again.
+// std140 layout, keep in sync with the block in the shaders
+struct FrameUniformData
+{
+    glm::mat4 proj;
+    glm::mat4 view;
+
+    //xyz, w unused
+    glm::vec4 camPos;
+    glm::vec4 dirLightDir;
+    glm::vec4 pointLightPos;
+
+    //animation time, advances every frame
+    float time;
+    float padding[3];
+};
+
+static_assert(sizeof(FrameUniformData) == 192, "FrameUniformData has to match the std140 FrameUniforms block");
+
+class FrameUniforms
+{
+private:
+    GLuint buffer;
+
+public:
+
+    static constexpr GLuint BINDING = 0;
+    static constexpr const char* BLOCK_NAME = "FrameUniforms";
+
+    FrameUniforms()
+    {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniformData), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, buffer);
+    }
+
+    ~FrameUniforms()
+    {
+        glDeleteBuffers(1, &buffer);
+    }
+
+    // lets the shader read the block, call once after creating it
+    static void bind(Shader* shader)
+    {
+        shader->bindUniformBlock(BLOCK_NAME, BINDING);
+    }
+
+    void update(const FrameUniformData& data)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniformData), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+};
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef GRASS_RENDERER_H
+#define GRASS_RENDERER_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "glad/glad.h"
+#include <glm/glm.hpp>
+
+#include "boundingVolume.h"
+#include "chunkQuadtree.h"
+#include "frameUniforms.h"
+#include "profiler.h"
+#include "grassField.h"
+#include "shader.h"
+#include "terrainChunk.h"
+
+// Draws the grass of the resident chunks, one instanced draw per visible chunk.
+//
+// Density falls off with distance from the camera. A blade is drawn while its
+// place in the chunk's priority order (see GrassField) is below the density at
+// the blade, and shrinks away over the last GRASS_FADE of that range, so blades
+// thin out smoothly instead of popping. Each chunk draws the prefix of its
+// buffer that its closest point needs. When the visible chunks want more than
+// the instance budget, every chunk's density is scaled down by the same factor
+class GrassRenderer
+{
+private:
+    Shader* grassShader;
+
+    GLuint instanceBudget;
+
+    GLint densityScaleLocation;
+    GLint chunkOriginLocation;
+    GLint heightScaleLocation;
+    GLint maxBladeHeightLocation;
+    GLint numBladesLocation;
+
+    GLuint bladesDrawn = 0;
+
+    struct GrassDraw
+    {
+        TerrainChunk* chunk;
+        float density;
+    };
+
+    //chunks in the frustum, then the ones that get drawn
+    std::vector<TerrainChunk*> visibleChunks;
+    std::vector<uint32_t> visibleTiles;
+    std::vector<GrassDraw> visible;
+
+    //3 segments of two vertices and the tip, see grass.vert
+    static constexpr GLsizei BLADE_VERTICES = 7;
+
+    //blades only grow this far out of the chunk's bounds
+    static constexpr float BLADE_MARGIN = 2.f;
+
+    //full density up to GRASS_FULL_DISTANCE, none from GRASS_MAX_DISTANCE
+    static constexpr float GRASS_FULL_DISTANCE = 32.f;
+    static constexpr float GRASS_MAX_DISTANCE = 160.f;
+
+    //fraction of the priority range over which a blade shrinks away, the density is
+    //stretched by 1 + GRASS_FADE so every blade is full size at density 1
+    static constexpr float GRASS_FADE = 0.1f;
+
+    //same falloff as grass.vert, stretched by the fade
+    static float getDensity(float distance)
+    {
+        float t = glm::clamp((distance - GRASS_FULL_DISTANCE) / (GRASS_MAX_DISTANCE - GRASS_FULL_DISTANCE), 0.f, 1.f);
+        return (1.f - t * t * (3.f - 2.f * t)) * (1.f + GRASS_FADE);
+    }
+
+public:
+
+    static constexpr GLuint DEFAULT_INSTANCE_BUDGET = 400000;
+
+    explicit GrassRenderer(GLuint instanceBudget = DEFAULT_INSTANCE_BUDGET)
+    {
+        this->instanceBudget = instanceBudget;
+
+        grassShader = new Shader("Assets/Shaders/grass.vert",
+                                 "Assets/Shaders/grass.frag");
+
+        FrameUniforms::bind(grassShader);
+
+        grassShader->use();
+        grassShader->setVec3("dirLight.ambient", glm::vec3(0.3f));
+        grassShader->setVec3("dirLight.diffuse", glm::vec3(0.7f));
+
+        grassShader->setVec2("windDir", glm::normalize(glm::vec2(1.f, 0.4f)));
+        grassShader->setFloat("windStrength", 0.25f);
+
+        grassShader->setVec2("densityRange", glm::vec2(GRASS_FULL_DISTANCE, GRASS_MAX_DISTANCE));
+        grassShader->setFloat("densityFade", GRASS_FADE);
+
+        densityScaleLocation = grassShader->getUniformLocation("densityScale");
+        chunkOriginLocation = grassShader->getUniformLocation("chunkOrigin");
+        heightScaleLocation = grassShader->getUniformLocation("heightScale");
+        maxBladeHeightLocation = grassShader->getUniformLocation("maxBladeHeight");
+        numBladesLocation = grassShader->getUniformLocation("numBlades");
+    }
+
+    ~GrassRenderer()
+    {
+        delete grassShader;
+    }
+
+    // most blades drawn in a frame, over all chunks
+    void setInstanceBudget(GLuint budget)
+    {
+        instanceBudget = budget;
+    }
+
+    GLuint getInstanceBudget()
+    {
+        return instanceBudget;
+    }
+
+    GLuint getBladesDrawn()
+    {
+        return bladesDrawn;
+    }
+
+    void draw(glm::mat4 view, glm::mat4 proj, const ChunkQuadtree<TerrainChunk*>& terrain)
+    {
+        PROFILE_SCOPE("grass");
+        PROFILE_GPU_SCOPE("grass");
+
+        glEnable(GL_DEPTH_TEST);
+
+        //blades are single quads seen from both sides
+        glDisable(GL_CULL_FACE);
+
+        Frustum frustum(view, proj);
+
+        glm::vec3 pos = glm::vec3(glm::inverse(view)[3]);
+
+        //density each visible chunk needs at its closest point
+        terrain.cull(frustum.getPlanes(), BLADE_MARGIN, visibleChunks);
+
+        visible.clear();
+        float wanted = 0.f;
+        for(TerrainChunk* chunk : visibleChunks)
+        {
+            if(chunk->getNumGrassBlades() == 0) continue;
+
+            chunk->getData()->getTileBounds().cull(frustum.getPlanes(), BLADE_MARGIN, visibleTiles);
+            if(visibleTiles.empty()) continue;
+
+            float density = getDensity(chunk->getDistance(pos));
+            if(density <= 0.f) continue;
+
+            visible.push_back({ chunk, density });
+            wanted += density * chunk->getNumGrassBlades();
+        }
+
+        float densityScale = wanted > instanceBudget ? instanceBudget / wanted : 1.f;
+
+        grassShader->use();
+        grassShader->setFloat(densityScaleLocation, densityScale);
+
+        bladesDrawn = 0;
+        for(GrassDraw& draw : visible)
+        {
+            TerrainChunk* chunk = draw.chunk;
+
+            //blades past this prefix are below the density everywhere in the chunk
+            GLuint numBlades = chunk->getNumGrassBlades();
+            GLuint count = std::min((GLuint)std::ceil(draw.density * densityScale * numBlades), numBlades);
+            if(count == 0) continue;
+
+            grassShader->setVec3(chunkOriginLocation, chunk->getOrigin());
+            grassShader->setFloat(heightScaleLocation, chunk->getData()->getHeightScale());
+            grassShader->setFloat(maxBladeHeightLocation, chunk->getData()->getGrass()->getMaxBladeHeight());
+            grassShader->setFloat(numBladesLocation, (float)numBlades);
+
+            glBindVertexArray(chunk->getGrassVertexArray());
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, BLADE_VERTICES, count);
+
+            bladesDrawn += count;
+        }
+        glBindVertexArray(0);
+
+        glEnable(GL_CULL_FACE);
+    }
+};
+
+#endif
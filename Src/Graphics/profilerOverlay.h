@@ -0,0 +1,114 @@
+#ifndef PROFILER_OVERLAY_H
+#define PROFILER_OVERLAY_H
+
+#include <cstring>
+#include <vector>
+
+#include "glad/glad.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "profiler.h"
+#include "shapeRenderer.h"
+
+// Rolling frame time graph of a few profiler zones, drawn with ShapeRenderer
+// lines in the bottom left corner of the screen. Every stage gets a strip with
+// one bar per frame for the last HISTORY frames, a full strip is STRIP_MS. A
+// stage's bar is the sum of its zones in that frame, matched by name
+class ProfilerOverlay
+{
+private:
+
+    struct Stage
+    {
+        const char* name;
+        bool gpu;
+        glm::vec3 color;
+        std::vector<float> history;
+    };
+
+    std::vector<Stage> stages;
+    size_t frame = 0;
+
+    uint64_t readIndex;
+    std::vector<ProfileRecord> records;
+
+    static constexpr float MARGIN = 8.f;
+    static constexpr float STRIP_HEIGHT = 40.f;
+    static constexpr float STRIP_GAP = 4.f;
+
+public:
+
+    static const size_t HISTORY = 240;
+
+    //a 60 Hz frame
+    static constexpr float STRIP_MS = 1000.f / 60.f;
+
+    ProfilerOverlay()
+    {
+        readIndex = Profiler::get().getWriteIndex();
+    }
+
+    // stages are drawn bottom up in the order they are added
+    void addStage(const char* name, glm::vec3 color, bool gpu = false)
+    {
+        stages.push_back({ name, gpu, color, std::vector<float>(HISTORY, 0.f) });
+    }
+
+    // takes the zones finished since the last call as one frame
+    void update()
+    {
+        records.clear();
+        readIndex = Profiler::get().readRecords(readIndex, records);
+
+        size_t slot = frame++ % HISTORY;
+        for(Stage& stage : stages)
+        {
+            float ms = 0.f;
+            for(const ProfileRecord& record : records)
+            {
+                if(record.gpu == stage.gpu && strcmp(record.name, stage.name) == 0)
+                {
+                    ms += (record.end - record.start) / 1e6f;
+                }
+            }
+
+            stage.history[slot] = ms;
+        }
+    }
+
+    void draw(ShapeRenderer* shapes, int width, int height)
+    {
+        //on top of everything, the lines are still depth tested
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        shapes->setProjectionMatrix(glm::ortho(0.f, (float)width, 0.f, (float)height, -1.f, 1.f));
+        shapes->begin(glm::mat4(1.f));
+
+        for(size_t s = 0; s < stages.size(); ++s)
+        {
+            Stage& stage = stages[s];
+            float y = MARGIN + s * (STRIP_HEIGHT + STRIP_GAP);
+
+            shapes->setColor(glm::vec3(0.3f));
+            shapes->line(MARGIN, y + STRIP_HEIGHT, 0.f, MARGIN + HISTORY, y + STRIP_HEIGHT, 0.f);
+
+            //oldest frame on the left
+            for(size_t i = 0; i < HISTORY; ++i)
+            {
+                float ms = stage.history[(frame + i) % HISTORY];
+                if(ms <= 0.f) continue;
+
+                //over budget bars are cut off and turn white
+                shapes->setColor(ms > STRIP_MS ? glm::vec3(1.f) : stage.color);
+
+                float x = MARGIN + i;
+                shapes->line(x, y, 0.f, x, y + glm::min(ms / STRIP_MS, 1.f) * STRIP_HEIGHT, 0.f);
+            }
+        }
+
+        shapes->end();
+    }
+};
+
+#endif
@@ -10,8 +10,15 @@
 #include "fastnoise/FastNoise.h"
 
 #include "camera.h"
+#include "chunkQuadtree.h"
+#include "profiler.h"
 #include "shader.h"
 
+#include "frameUniforms.h"
+#include "grassRenderer.h"
+#ifndef PROFILER_DISABLED
+#include "profilerOverlay.h"
+#endif
 #include "shapeRenderer.h"
 #include "skyboxRenderer.h"
 #include "terrainRenderer.h"
@@ -34,12 +41,115 @@ private:
 
     ShapeRenderer* shapeRenderer;
     TerrainRenderer* terrainRenderer;
+    GrassRenderer* grassRenderer;
     SkyboxRenderer* skyboxRenderer;
 
+#ifndef PROFILER_DISABLED
+    //null while hidden
+    ProfilerOverlay* profilerOverlay = nullptr;
+#endif
 
-    std::vector<TerrainChunk*> chunks;
+    FrameUniforms* frameUniforms;
+    glm::vec3 pointLightPos;
+
+    //locations in the shader of the models, resolved again when it changes
+    struct ModelUniforms
+    {
+        Shader* shader = nullptr;
+
+        GLint proj;
+        GLint view;
+        GLint model;
+        GLint dirLightDir;
+        GLint dirLightColor;
+        GLint ambient;
+        GLint diffuse;
+        GLint specular;
+        GLint shininess;
+    };
+
+    ModelUniforms modelUniforms;
+
+    //owned by the ChunkManager, which keeps it up to date as chunks stream in and out
+    const ChunkQuadtree<TerrainChunk*>* terrain = nullptr;
     float elapsed = 0;
 
+    void useModelShader(Shader* shader, glm::mat4 view, glm::mat4 proj)
+    {
+        shader->use();
+
+        if(shader != modelUniforms.shader)
+        {
+            modelUniforms.shader = shader;
+            modelUniforms.proj = shader->getUniformLocation("proj");
+            modelUniforms.view = shader->getUniformLocation("view");
+            modelUniforms.model = shader->getUniformLocation("model");
+            modelUniforms.dirLightDir = shader->getUniformLocation("dirLight.dir");
+            modelUniforms.dirLightColor = shader->getUniformLocation("dirLight.color");
+            modelUniforms.ambient = shader->getUniformLocation("material.ambient");
+            modelUniforms.diffuse = shader->getUniformLocation("material.diffuse");
+            modelUniforms.specular = shader->getUniformLocation("material.specular");
+            modelUniforms.shininess = shader->getUniformLocation("material.shininess");
+        }
+
+        shader->setMat4(modelUniforms.proj, proj);
+        shader->setMat4(modelUniforms.view, view);
+        shader->setVec3(modelUniforms.dirLightDir, glm::vec3(0, 0.5f, 1.f));
+        shader->setVec3(modelUniforms.dirLightColor, glm::vec3(0.6f));
+    }
+
+    void drawScene(glm::mat4 view)
+    {
+        elapsed += 0.01f;
+
+        glm::mat4 proj = glm::perspective(45.f, 1280.f/720.f, 4.f, 1024.f);
+
+        
+        FrameUniformData frame;
+        frame.proj = proj;
+        frame.view = view;
+        frame.camPos = glm::vec4(glm::vec3(glm::inverse(view)[3]), 1.f);
+        frame.dirLightDir = glm::vec4(glm::normalize(glm::vec3(0.f, 0.5f, 0.f)), 0.f);
+        frame.pointLightPos = glm::vec4(pointLightPos, 1.f);
+        frame.time = elapsed;
+        frameUniforms->update(frame);
+
+        //every model shares one shader, its per-frame uniforms are only set when it changes
+        Shader* modelShader = nullptr;
+        for(size_t i = 0; i < modelsToDraw.size(); ++i)
+        {
+            if(modelsToDraw[i]->getShader() != modelShader)
+            {
+                modelShader = modelsToDraw[i]->getShader();
+                useModelShader(modelShader, view, proj);
+            }
+
+            modelShader->setMat4(modelUniforms.model, modelMatrices[i]);
+
+            for (auto mesh : modelsToDraw[i]->getMeshes()) 
+            {
+                modelShader->setVec4(modelUniforms.ambient,    mesh->material.ambient);
+                modelShader->setVec4(modelUniforms.diffuse,    mesh->material.diffuse);
+                modelShader->setVec4(modelUniforms.specular,   mesh->material.specular);    
+                modelShader->setFloat(modelUniforms.shininess, mesh->material.shininess);
+
+                glBindVertexArray(mesh->getVertexArray());
+                glDrawElements(GL_TRIANGLES, mesh->numIndices, GL_UNSIGNED_INT, 0);
+            }
+
+        }
+        modelsToDraw.clear();
+        modelMatrices.clear();
+        
+        if(terrain)
+        {
+            terrainRenderer->draw(view, proj, *terrain);
+            grassRenderer->draw(view, proj, *terrain);
+        }
+        skyboxRenderer->draw(view);
+    
+    }
+
     SDL_Window* window;
 
     std::vector<Model*> modelsToDraw;
@@ -62,8 +172,10 @@ public:
 
         shapeRenderer = new ShapeRenderer();
         terrainRenderer = new TerrainRenderer();
+        grassRenderer = new GrassRenderer();
         skyboxRenderer = new SkyboxRenderer();
 
+        frameUniforms = new FrameUniforms();
     }
 
     void queueModel(Model* model, glm::mat4 transform)
@@ -72,9 +184,9 @@ public:
         modelMatrices.push_back(transform);
     }
 
-    void setTerrain(std::vector<TerrainChunk*> chunks)
+    void setTerrain(const ChunkQuadtree<TerrainChunk*>* terrain)
     {
-        this->chunks = chunks;
+        this->terrain = terrain;
     }
 
     ~Renderer()
@@ -84,45 +196,66 @@ public:
 
     void setPointLightPos(glm::vec3 pos)
     {
-        terrainRenderer->setPointLightPos(pos);
+        pointLightPos = pos;
     }
 
-    void draw(glm:: mat4 view)
-    {        
-        elapsed += 0.01f;
+    void setGrassInstanceBudget(GLuint budget)
+    {
+        grassRenderer->setInstanceBudget(budget);
+    }
 
-        glm::mat4 proj = glm::perspective(45.f, 1280.f/720.f, 4.f, 1024.f);
+#ifndef PROFILER_DISABLED
+    // the overlay only reads the profiler while shown, its graph starts empty every time
+    void setProfilerOverlayVisible(bool visible)
+    {
+        if(visible == isProfilerOverlayVisible()) return;
 
-        
-        for(size_t i = 0; i < modelsToDraw.size(); ++i)
+        if(!visible)
         {
-            modelsToDraw[i]->getShader()->use();
-            modelsToDraw[i]->getShader()->setMat4("proj", proj);
-            modelsToDraw[i]->getShader()->setMat4("view", view);
-            modelsToDraw[i]->getShader()->setMat4("model", modelMatrices[i]);
+            delete profilerOverlay;
+            profilerOverlay = nullptr;
+            return;
+        }
 
-            modelsToDraw[i]->getShader()->setVec3("dirLight.dir", glm::vec3(0, 0.5f, 1.f));
-            modelsToDraw[i]->getShader()->setVec3("dirLight.color", glm::vec3(0.6f));
+        //the zones Game and the renderers open, bottom up
+        profilerOverlay = new ProfilerOverlay();
+        profilerOverlay->addStage("swap", glm::vec3(0.5f));
+        profilerOverlay->addStage("physics", glm::vec3(0.9f, 0.3f, 0.3f));
+        profilerOverlay->addStage("chunks", glm::vec3(0.9f, 0.6f, 0.2f));
+        profilerOverlay->addStage("renderer", glm::vec3(0.3f, 0.5f, 0.9f));
+        profilerOverlay->addStage("terrain", glm::vec3(0.3f, 0.8f, 0.4f));
+        profilerOverlay->addStage("terrain", glm::vec3(0.1f, 0.5f, 0.2f), true);
+        profilerOverlay->addStage("grass", glm::vec3(0.7f, 0.9f, 0.3f));
+        profilerOverlay->addStage("grass", glm::vec3(0.4f, 0.6f, 0.1f), true);
+        profilerOverlay->addStage("skybox", glm::vec3(0.5f, 0.8f, 0.9f));
+    }
 
-            for (auto mesh : modelsToDraw[i]->getMeshes()) 
-            {
-                modelsToDraw[i]->getShader()->setVec4("material.ambient",    mesh->material.ambient);
-                modelsToDraw[i]->getShader()->setVec4("material.diffuse",    mesh->material.diffuse);
-                modelsToDraw[i]->getShader()->setVec4("material.specular",   mesh->material.specular);    
-                modelsToDraw[i]->getShader()->setFloat("material.shininess", mesh->material.shininess);
+    bool isProfilerOverlayVisible()
+    {
+        return profilerOverlay != nullptr;
+    }
+#endif
 
-                glBindVertexArray(mesh->getVertexArray());
-                glDrawElements(GL_TRIANGLES, mesh->numIndices, GL_UNSIGNED_INT, 0);
-            }
+    void draw(glm:: mat4 view)
+    {        
+        {
+            PROFILE_SCOPE("renderer");
+            PROFILE_GPU_SCOPE("renderer");
 
+            drawScene(view);
         }
-        modelsToDraw.clear();
-        modelMatrices.clear();
-        
-        terrainRenderer->draw(view, proj, chunks);
-        skyboxRenderer->draw(view);
-    
-    }    
+
+#ifndef PROFILER_DISABLED
+        if(profilerOverlay)
+        {
+            profilerOverlay->update();
+
+            int width, height;
+            SDL_GetWindowSize(window, &width, &height);
+            profilerOverlay->draw(shapeRenderer, width, height);
+        }
+#endif
+    }
 };
 
 #endif
\ No newline at end of file
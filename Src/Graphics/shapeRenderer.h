@@ -31,6 +31,9 @@ private:
     bool running = false;
 
     Shader* shader;
+
+    GLint projLocation;
+    GLint viewLocation;
     
     void flush()
     {
@@ -43,8 +46,8 @@ private:
         glEnable(GL_DEPTH_TEST);
 
         shader->use();
-        shader->setMat4("proj", projection);
-        shader->setMat4("view", view);
+        shader->setMat4(projLocation, projection);
+        shader->setMat4(viewLocation, view);
 
         glBindVertexArray(VAO);
 
@@ -77,6 +80,9 @@ public:
         shader = new Shader("Assets/Shaders/shapeRenderer.vert", 
                             "Assets/Shaders/shapeRenderer.frag");
 
+        projLocation = shader->getUniformLocation("proj");
+        viewLocation = shader->getUniformLocation("view");
+
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
 
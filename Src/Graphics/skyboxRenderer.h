@@ -6,6 +6,7 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#include "profiler.h"
 #include "shader.h"
 
 #include <vector>
@@ -70,6 +71,9 @@ private:
 
     Shader* skyboxShader;
 
+    GLint projLocation;
+    GLint viewLocation;
+
 public:
     SkyboxRenderer()
     {
@@ -125,6 +129,9 @@ public:
 
         skyboxShader->use();
         skyboxShader->setInt("cubemap", 0);
+
+        projLocation = skyboxShader->getUniformLocation("proj");
+        viewLocation = skyboxShader->getUniformLocation("view");
     }
 
     ~SkyboxRenderer()
@@ -136,11 +143,14 @@ public:
 
     void draw(glm::mat4 view)
     {
+        PROFILE_SCOPE("skybox");
+        PROFILE_GPU_SCOPE("skybox");
+
         skyboxShader->use();
         glm::mat4 proj = glm::perspective(45.f, 1280.f/720.f, 0.01f, 10000.f);
         view = glm::mat4(glm::mat3(view)); // remove translation from the view matrix
-        skyboxShader->setMat4("proj", proj);
-        skyboxShader->setMat4("view", view);
+        skyboxShader->setMat4(projLocation, proj);
+        skyboxShader->setMat4(viewLocation, view);
         
         
         glEnable(GL_DEPTH_TEST);
@@ -10,6 +10,9 @@
 #include <glm/gtx/transform.hpp>
 
 #include "boundingVolume.h"
+#include "chunkQuadtree.h"
+#include "frameUniforms.h"
+#include "profiler.h"
 #include "shader.h"
 #include "terrainChunk.h"
 
@@ -18,15 +21,68 @@ class TerrainRenderer
 private:
     Shader* terrainShader;
 
-    glm::vec3 pointLightPos;
+    //visible chunks of one arena, drawn together. Kept between frames for their storage
+    struct TerrainBatch
+    {
+        TerrainChunkArena* arena;
+        std::vector<TerrainDrawCommand> commands;
+        std::vector<TerrainDrawData> drawData;
+    };
+
+    //kept between frames for their storage
+    std::vector<TerrainChunk*> visibleChunks;
+    std::vector<uint32_t> visibleTiles;
+
+    std::vector<TerrainBatch> batches;
+    size_t numBatches = 0;
+
+    GLuint trianglesDrawn = 0;
+    GLuint drawCalls = 0;
+
+    TerrainBatch& getBatch(TerrainChunkArena* arena)
+    {
+        for(size_t i = 0; i < numBatches; ++i)
+        {
+            if(batches[i].arena == arena) return batches[i];
+        }
+
+        if(numBatches == batches.size()) batches.emplace_back();
+
+        TerrainBatch& batch = batches[numBatches++];
+        batch.arena = arena;
+        batch.commands.clear();
+        batch.drawData.clear();
+        return batch;
+    }
+
+    //LOD level L is used up to LOD_BASE_DISTANCE * 2^L from the camera,
+    //the last LOD_MORPH_FRACTION of that band morphs towards level L + 1
+    static constexpr float LOD_BASE_DISTANCE = 160.f;
+    static constexpr float LOD_MORPH_FRACTION = 0.25f;
 
 public:
 
     TerrainRenderer()
     {
-        terrainShader = new Shader("Assets/Shaders/terrain.vert", 
-                                   "Assets/Shaders/terrain.frag");
-        
+        terrainShader = new Shader("Assets/Shaders/terrainPacked.vert", 
+                                   "Assets/Shaders/terrainPacked.frag");
+
+        FrameUniforms::bind(terrainShader);
+
+        //the light colors never change, the camera and light positions come from FrameUniforms
+        terrainShader->use();
+        terrainShader->setVec3("dirLight.ambient", glm::vec3(0.05f));
+        terrainShader->setVec3("dirLight.diffuse", glm::vec3(0.1f));
+        terrainShader->setVec3("dirLight.specular", glm::vec3(0.1f));	
+
+        terrainShader->setVec3("pointLight.ambient", glm::vec3(0.8f));
+        terrainShader->setVec3("pointLight.diffuse", glm::vec3(0.9f));
+        terrainShader->setVec3("pointLight.specular", glm::vec3(0.3f));	
+        terrainShader->setFloat("pointLight.constant", 1.f);
+        terrainShader->setFloat("pointLight.linear",   0.027f);
+        terrainShader->setFloat("pointLight.quadratic", 0.0028f);
+
+        terrainShader->setInt("maxLodLevels", TerrainIndexBuffer::MAX_LOD_LEVELS);
     }
 
     ~TerrainRenderer()
@@ -34,53 +90,92 @@ public:
         delete terrainShader;
     }
 
-    void setPointLightPos(glm::vec3 pos)
+    GLuint getTrianglesDrawn()
+    {
+        return trianglesDrawn;
+    }
+
+    // GL draw calls the last frame took, one per arena when multi draw is supported
+    GLuint getDrawCalls()
     {
-        pointLightPos = pos;
+        return drawCalls;
     }
 
-    void draw(glm::mat4 view, glm::mat4 proj, std::vector<TerrainChunk*>& chunks)
+    void draw(glm::mat4 view, glm::mat4 proj, const ChunkQuadtree<TerrainChunk*>& terrain)
     {
+        PROFILE_SCOPE("terrain");
+        PROFILE_GPU_SCOPE("terrain");
+
         glEnable(GL_DEPTH_TEST);
 
 
         Frustum frustum(view, proj);
 
         terrainShader->use();
-        terrainShader->setMat4("proj", proj);
-        terrainShader->setMat4("view", view);
-
-        terrainShader->setVec3("dirLight.dir", glm::normalize(glm::vec3(0.f, 0.5f, 0.f)));
-        terrainShader->setVec3("dirLight.ambient", glm::vec3(0.05f));
-        terrainShader->setVec3("dirLight.diffuse", glm::vec3(0.1f));
-        terrainShader->setVec3("dirLight.specular", glm::vec3(0.1f));	
 
-        terrainShader->setVec3("pointLight.pos", pointLightPos);
-        terrainShader->setVec3("pointLight.ambient", glm::vec3(0.8f));
-        terrainShader->setVec3("pointLight.diffuse", glm::vec3(0.9f));
-        terrainShader->setVec3("pointLight.specular", glm::vec3(0.3f));	
-        terrainShader->setFloat("pointLight.constant", 1.f);
-        terrainShader->setFloat("pointLight.linear",   0.027f);
-        terrainShader->setFloat("pointLight.quadratic", 0.0028f);
+        glm::vec3 pos = glm::vec3(glm::inverse(view)[3]);
 
-        glm::vec3 pos;
-        pos.x = view[3][0];
-        pos.y = view[3][1];
-        pos.z = view[3][2];
-        terrainShader->setVec3("camPos", pos);
+        trianglesDrawn = 0;
+        numBatches = 0;
+        terrain.cull(frustum.getPlanes(), 0.f, visibleChunks);
 
-        for(TerrainChunk* chunk : chunks)
+        for(TerrainChunk* chunk : visibleChunks)
         {
-            BoundingBox box(chunk->getWorldMin(), chunk->getWorldMax());
+            //the chunk's box can reach into the frustum while none of its tiles do, like a
+            //peak poking up behind a valley
+            chunk->getData()->getTileBounds().cull(frustum.getPlanes(), 0.f, visibleTiles);
+            if(visibleTiles.empty()) continue;
+
+            TerrainIndexBuffer* indices = chunk->getIndexBuffer();
 
-            if(frustum.testIntersection(box) != BoundingVolume::TEST_OUTSIDE)
+            float distance = chunk->getDistance(pos);
+
+            int level = 0;
+            while(level < indices->getNumLevels() - 1 && distance >= LOD_BASE_DISTANCE * (1 << level))
+            {
+                level++;
+            }
+
+            //the coarsest level has nothing to morph into
+            glm::vec2 morphRange(1e30f, 2e30f);
+            if(level < indices->getNumLevels() - 1)
             {
-                glBindVertexArray(chunk->getVertexArray());
-                glDrawElements(GL_TRIANGLES, chunk->getNumIndices(), GL_UNSIGNED_INT, 0);
+                float bandEnd = LOD_BASE_DISTANCE * (1 << level);
+                morphRange = glm::vec2(bandEnd * (1.f - LOD_MORPH_FRACTION), bandEnd);
             }
-            
+
+            TerrainBatch& batch = getBatch(chunk->getArena());
+
+            glm::vec3 origin = chunk->getOrigin();
+
+            TerrainDrawData data;
+            data.originX = origin.x;
+            data.originY = origin.y;
+            data.originZ = origin.z;
+            data.heightScale = chunk->getData()->getHeightScale();
+            data.morphStart = morphRange.x;
+            data.morphEnd = morphRange.y;
+            data.lodLevel = level;
+            data.gridSize = chunk->getData()->getTerrainSize() + 2;
+
+            TerrainDrawCommand command;
+            command.count = indices->getNumIndices(level);
+            command.instanceCount = 1;
+            command.firstIndex = indices->getOffset(level);
+            command.baseVertex = chunk->getBaseVertex();
+            command.baseInstance = batch.drawData.size();
+
+            batch.commands.push_back(command);
+            batch.drawData.push_back(data);
+
+            trianglesDrawn += indices->getNumIndices(level) / 3;
+        }
+
+        drawCalls = 0;
+        for(size_t i = 0; i < numBatches; ++i)
+        {
+            drawCalls += batches[i].arena->draw(batches[i].commands, batches[i].drawData);
         }
-        glBindVertexArray(0);
     }
 };
 
@@ -1,53 +1,57 @@
 #ifndef GAME_PHYSICS_H
 #define GAME_PHYSICS_H
 
+#include <atomic>
 #include <chrono>
 #include <iostream>
+#include <mutex>
+#include <string>
 
 #include <bullet/btBulletDynamicsCommon.h>
 #include <glm/gtc/quaternion.hpp>
 #include <thread>
 #include <future>
+#include <unordered_map>
+#include <unordered_set>
 
+#include "chunkData.h"
+#include "chunkQuadtree.h"
+#include "collisionCache.h"
+#include "profiler.h"
 #include "terrainChunk.h"
+#include "terrainCollision.h"
+#include "threadPool.h"
+#include "utils.h"
 
 #include "player.h"
 
-static btRigidBody* generateTriMesh(TerrainChunk* chunk)
+// Bullet world stepped at a fixed TICK_RATE on its own thread once started.
+// After every tick the player's transform is published to its TransformSnapshot,
+// the render thread only ever reads those. Everything else that touches the
+// world from another thread takes worldMutex, which a tick holds throughout, so
+// it waits for the tick in progress to finish.
+//
+// Terrain only gets collision near dynamic bodies. updateTerrainCollision builds
+// bodies on the shared pool for the chunks within the collision radius of one and
+// drops them again once every body is well past. Terrain bodies are owned by the
+// main thread and join or leave the world through a queue the next tick applies,
+// they keep no reference to their chunk so that never has to wait for a tick.
+// With a collision cache, terrain met before gets its BVH back instead of a new build
+class PhysicsSim
 {
-    btTriangleIndexVertexArray* idxVertArr = 
-        new btTriangleIndexVertexArray(chunk->getNumIndices() / 3,
-                                            chunk->getIndexBuffer(),
-                                            sizeof(int) * 3,
-                                            chunk->getNumVertices(),
-                                            (btScalar*)&chunk->getPositionBuffer()[0],
-                                            sizeof(glm::vec3));
-    btVector3 min(chunk->getWorldMin().x,
-                    chunk->getWorldMin().y,
-                    chunk->getWorldMin().z);
-    btVector3 max(chunk->getWorldMax().x,
-                    chunk->getWorldMax().y,
-                    chunk->getWorldMax().z);
-
-    btCollisionShape* trimeshShape  = 
-            new btBvhTriangleMeshShape(idxVertArr,true,min,max);
-    
+public:
 
-    btTransform startTransform;
-    startTransform.setIdentity();
+    static const int TICK_RATE = 60;
 
-        //using motionstate is recommended, it provides interpolation capabilities, and only synchronizes 'active' objects
-    btDefaultMotionState* myMotionState = new btDefaultMotionState(startTransform);
-    btRigidBody::btRigidBodyConstructionInfo rbInfo(0.f,myMotionState,trimeshShape,btVector3(0,0,0));
-    btRigidBody* body = new btRigidBody(rbInfo);
+    //ticks run back to back to catch up after a stall, further behind the simulation just slows down
+    static const int MAX_CATCH_UP_TICKS = 4;
 
-    body->setCollisionFlags(body->getCollisionFlags() | btCollisionObject::CF_KINEMATIC_OBJECT);
+    //seconds of a body's horizontal velocity added to the collision radius
+    static constexpr float COLLISION_LOOKAHEAD = 0.5f;
 
-    return body;
-}
+    //terrain bodies are dropped at this times the radius they were built at, so they don't flicker at the edge
+    static constexpr float COLLISION_KEEP_FACTOR = 2.f;
 
-class PhysicsSim
-{
 private:
     
     btDefaultCollisionConfiguration* collisionConfig;
@@ -59,11 +63,137 @@ private:
     
     btAlignedObjectArray<btCollisionShape*> collisionShapes;
 
-    
+    TerrainCollisionBackend terrainBackend = TERRAIN_COLLISION_BVH;
+
+    //outlives every terrain body, it owns their Bullet objects
+    TerrainCollider terrainCollider;
+    CollisionCache* collisionCache = nullptr;
+
+    //main thread only, bodies in terrainBodies are in the world or queued to join it
+    float collisionRadius;
+    std::unordered_map<ChunkData*, btRigidBody*> terrainBodies;
+    std::unordered_map<ChunkData*, std::future<btRigidBody*>> pendingTerrainBodies;
+
+    //scratch for updateTerrainCollision
+    std::vector<TerrainChunk*> nearChunks;
+    std::unordered_set<ChunkData*> keptChunks;
+
+    std::mutex worldMutex;
+
+    //terrain bodies handed to the next tick, which adds them and removes and destroys the others
+    std::mutex queueMutex;
+    std::vector<btRigidBody*> addedBodies;
+    std::vector<btRigidBody*> removedBodies;
+
+    struct BodyState
+    {
+        glm::vec3 position;
+        glm::vec3 velocity;
+    };
+
+    //where the dynamic bodies were after the last tick
+    std::mutex bodyStateMutex;
+    std::vector<BodyState> bodyStates;
+    std::vector<BodyState> nearBodies;
+
+    Player* player = nullptr;
+    std::vector<btRigidBody*> dynamicBodies;
+
+    std::thread thread;
+    std::atomic<bool> running;
+
+    //worldMutex held
+    void applyQueuedBodies()
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+
+        for(btRigidBody* body : addedBodies)
+        {
+            dynamicWorld->addRigidBody(body);
+        }
+        addedBodies.clear();
+
+        for(btRigidBody* body : removedBodies)
+        {
+            dynamicWorld->removeRigidBody(body);
+            terrainCollider.release(body);
+        }
+        removedBodies.clear();
+    }
+
+    //worldMutex held
+    void publishBodyStates()
+    {
+        std::lock_guard<std::mutex> lock(bodyStateMutex);
+
+        //sleeping bodies count too, they need the ground they rest on once woken
+        bodyStates.clear();
+        for(btRigidBody* body : dynamicBodies)
+        {
+            bodyStates.push_back({ bulletToGlm(body->getWorldTransform().getOrigin()), bulletToGlm(body->getLinearVelocity()) });
+        }
+    }
+
+    void tick(double time)
+    {
+        PROFILE_SCOPE("physics");
+
+        std::lock_guard<std::mutex> lock(worldMutex);
+        applyQueuedBodies();
+
+        if(player) player->applyForce();
+
+        //exactly one internal step, the tick is the fixed step
+        dynamicWorld->stepSimulation(1.f / TICK_RATE, 1, 1.f / TICK_RATE);
+
+        if(player) player->publishTransform(time);
+        publishBodyStates();
+    }
+
+    std::future<btRigidBody*> submitTerrainBody(ChunkData* chunk)
+    {
+        TerrainCollisionBackend backend = terrainBackend;
+        return ThreadPool::getShared().submit([this, chunk, backend]
+        {
+            return terrainCollider.create(chunk, backend);
+        });
+    }
+
+    void run()
+    {
+        PROFILE_THREAD_NAME("physics");
+
+        typedef std::chrono::steady_clock TickClock;
+        TickClock::duration tickLength = std::chrono::duration_cast<TickClock::duration>(std::chrono::duration<double>(1.0 / TICK_RATE));
+
+        //ticks are stamped with when they were due, on the clock of TransformSnapshot::now
+        TickClock::time_point next = TickClock::now();
+        while(running)
+        {
+            tick(std::chrono::duration<double>(next.time_since_epoch()).count());
+            next += tickLength;
+
+            TickClock::time_point now = TickClock::now();
+            if(now - next > MAX_CATCH_UP_TICKS * tickLength) next = now;
+
+            std::this_thread::sleep_until(next);
+        }
+    }
 
 public:
-    PhysicsSim()
+
+    // terrain gets collision within collisionRadius of a dynamic body, measured horizontally.
+    // Without a cachePath every terrain BVH is built
+    PhysicsSim(float collisionRadius, const WorldConfig& config, const std::string& cachePath = "")
     {
+        this->collisionRadius = collisionRadius;
+
+        if(!cachePath.empty())
+        {
+            collisionCache = new CollisionCache(cachePath, config);
+            terrainCollider.setCache(collisionCache);
+        }
+
         collisionConfig = new btDefaultCollisionConfiguration();
         collisionDispatcher = new btCollisionDispatcher(collisionConfig);
         overlappingCache = new btDbvtBroadphase();
@@ -75,15 +205,40 @@ public:
                                                    collisionConfig);
 
         dynamicWorld->setGravity(btVector3(0, -128, 0));
+
+        running = false;
     }
 
     ~PhysicsSim()
     {
+        stop();
+
+        collectTerrainBodies(true);
+        applyQueuedBodies();
+        for(auto& body : terrainBodies)
+        {
+            dynamicWorld->removeRigidBody(body.second);
+            terrainCollider.release(body.second);
+        }
+
+        for(btRigidBody* body : dynamicBodies)
+        {
+            dynamicWorld->removeRigidBody(body);
+            delete body->getMotionState();
+            delete body;
+        }
+        for(int i = 0; i < collisionShapes.size(); ++i)
+        {
+            delete collisionShapes[i];
+        }
+
         delete dynamicWorld;
         delete solver;
         delete overlappingCache;
         delete collisionDispatcher;
         delete collisionConfig;
+
+        delete collisionCache;
     }
     
     void createPlayerRigidBody(Player* player)
@@ -115,78 +270,164 @@ public:
         btRigidBody* body = new btRigidBody(rbInfo);
         
         player->setRigidBody(body);
+
+        std::lock_guard<std::mutex> lock(worldMutex);
         dynamicWorld->addRigidBody(body);
+        dynamicBodies.push_back(body);
+        this->player = player;
+
+        //so terrain under the start position can be built before the first tick
+        publishBodyStates();
     }
 
-    void createTerrainCollisionShapes(std::vector<TerrainChunk*> chunks)
+    // starts ticking on the physics thread
+    void start()
     {
+        if(running) return;
 
+        running = true;
+        thread = std::thread(&PhysicsSim::run, this);
+    }
 
-#define PHYSICS_MULTITHREAD_PATH
-#ifdef PHYSICS_MULTITHREAD_PATH
-    std::vector<std::future<btRigidBody*>> futures;
-    for(TerrainChunk* chunk : chunks)
+    void stop()
     {
-        futures.push_back(std::async(generateTriMesh, chunk));
+        if(!running) return;
+
+        running = false;
+        thread.join();
     }
 
-    for(size_t i = 0; i < futures.size(); ++i)
+    // builds collision for the resident chunks near dynamic bodies and drops it
+    // for the ones every body has left, call once per frame on the main thread
+    void updateTerrainCollision(const ChunkQuadtree<TerrainChunk*>& terrain)
     {
-        dynamicWorld->addRigidBody(futures[i].get());
-    }   
-#else
- 
-        for(TerrainChunk* chunk : chunks)
+        PROFILE_SCOPE("terrain collision");
+
         {
-            btTriangleIndexVertexArray* idxVertArr = 
-                    new btTriangleIndexVertexArray(chunk->getNumIndices() / 3,
-                                                   chunk->getIndexBuffer(),
-                                                   sizeof(int) * 3,
-                                                   chunk->getNumVertices(),
-                                                   (btScalar*)&chunk->getPositionBuffer()[0],
-                                                   sizeof(glm::vec3));
-            btVector3 min(chunk->getWorldMin().x,
-                          chunk->getWorldMin().y,
-                          chunk->getWorldMin().z);
-            btVector3 max(chunk->getWorldMax().x,
-                          chunk->getWorldMax().y,
-                          chunk->getWorldMax().z);
+            std::lock_guard<std::mutex> lock(bodyStateMutex);
+            nearBodies = bodyStates;
+        }
 
-            btCollisionShape* trimeshShape  = 
-                    new btBvhTriangleMeshShape(idxVertArr,true,min,max);
-	        
-            collisionShapes.push_back(trimeshShape);
+        nearChunks.clear();
+        keptChunks.clear();
+        for(const BodyState& body : nearBodies)
+        {
+            //fast bodies get their ground before they reach it
+            float radius = collisionRadius + glm::length(glm::vec3(body.velocity.x, 0.f, body.velocity.z)) * COLLISION_LOOKAHEAD;
+
+            size_t first = nearChunks.size();
+            terrain.findInColumn(body.position, radius * COLLISION_KEEP_FACTOR, nearChunks);
+            for(size_t i = first; i < nearChunks.size(); ++i)
+            {
+                keptChunks.insert(nearChunks[i]->getData());
+            }
+
+            nearChunks.resize(first);
+            terrain.findInColumn(body.position, radius, nearChunks);
+        }
 
-            btTransform startTransform;
-            startTransform.setIdentity();
+        for(TerrainChunk* chunk : nearChunks)
+        {
+            ChunkData* data = chunk->getData();
+            if(!terrainBodies.count(data) && !pendingTerrainBodies.count(data)) pendingTerrainBodies[data] = submitTerrainBody(data);
+        }
 
-             //using motionstate is recommended, it provides interpolation capabilities, and only synchronizes 'active' objects
-            btDefaultMotionState* myMotionState = new btDefaultMotionState(startTransform);
-            btRigidBody::btRigidBodyConstructionInfo rbInfo(0.f,myMotionState,trimeshShape,btVector3(0,0,0));
-            btRigidBody* body = new btRigidBody(rbInfo);
+        collectTerrainBodies(false);
 
-            body->setCollisionFlags(body->getCollisionFlags() | btCollisionObject::CF_KINEMATIC_OBJECT);
+        //builds still in flight are left to finish, they go on a later update
+        std::lock_guard<std::mutex> lock(queueMutex);
+        for(auto it = terrainBodies.begin(); it != terrainBodies.end();)
+        {
+            if(keptChunks.count(it->first))
+            {
+                ++it;
+                continue;
+            }
+
+            removedBodies.push_back(it->second);
+            it = terrainBodies.erase(it);
+        }
+    }
 
-            dynamicWorld->addRigidBody(body);
+    // the chunk can be deleted once this returns, its body may stay in the world until the next tick
+    void removeTerrainChunk(ChunkData* chunk)
+    {
+        auto pending = pendingTerrainBodies.find(chunk);
+        if(pending != pendingTerrainBodies.end())
+        {
+            //the job reads the chunk's buffers, wait for it before the chunk goes away
+            terrainCollider.release(pending->second.get());
+            pendingTerrainBodies.erase(pending);
+        }
+
+        auto body = terrainBodies.find(chunk);
+        if(body != terrainBodies.end())
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            removedBodies.push_back(body->second);
+            terrainBodies.erase(body);
+        }
+    }
+
+    // queues the finished builds to join the world on the next tick
+    void collectTerrainBodies(bool wait)
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        for(auto it = pendingTerrainBodies.begin(); it != pendingTerrainBodies.end();)
+        {
+            if(!wait && it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                ++it;
+                continue;
+            }
+
+            btRigidBody* body = it->second.get();
+            addedBodies.push_back(body);
+            terrainBodies[it->first] = body;
+
+            it = pendingTerrainBodies.erase(it);
         }
-#endif
     }
 
-    void step()
+    // chunks with collision, built or queued to join the world
+    size_t getNumTerrainBodies()
     {
-        dynamicWorld->stepSimulation(1.f/60.f, 32);
+        return terrainBodies.size();
+    }
 
-        // for (int j=dynamicWorld->getNumCollisionObjects()-1; j>=0 ;j--)
-		// {
-		// 	btCollisionObject* obj = dynamicWorld->getCollisionObjectArray()[j];
-		// 	btRigidBody* body = btRigidBody::upcast(obj);
-		// 	if (body && body->getMotionState())
-		// 	{
-		// 		btTransform trans;
-		// 		body->getMotionState()->getWorldTransform(trans);
-		// 		printf("world pos = %f,%f,%f\n",float(trans.getOrigin().getX()),float(trans.getOrigin().getY()),float(trans.getOrigin().getZ()));
-		// 	}
-		// }
+    TerrainCollisionBackend getTerrainCollisionBackend()
+    {
+        return terrainBackend;
+    }
+
+    // rebuilds every terrain body with the new backend, blocks until they are all
+    // built. The old ones are swapped out on a single tick, the world never goes without
+    void setTerrainCollisionBackend(TerrainCollisionBackend backend)
+    {
+        if(backend == terrainBackend) return;
+        terrainBackend = backend;
+
+        collectTerrainBodies(true);
+
+        std::vector<std::pair<ChunkData*, std::future<btRigidBody*>>> rebuilt;
+        for(auto& body : terrainBodies)
+        {
+            rebuilt.emplace_back(body.first, submitTerrainBody(body.first));
+        }
+        for(auto& body : rebuilt)
+        {
+            body.second.wait();
+        }
+
+        std::lock_guard<std::mutex> lock(queueMutex);
+        for(auto& body : rebuilt)
+        {
+            btRigidBody*& current = terrainBodies[body.first];
+            removedBodies.push_back(current);
+
+            current = body.second.get();
+            addedBodies.push_back(current);
+        }
     }
 };
 
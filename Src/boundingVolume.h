@@ -58,10 +58,19 @@ public:
 
         Frustum( const mat4 &viewMatrix, const mat4 &projectionMatrix );
 
-        const vec4 &getPlane( const int plane ) const;
+        const vec4 &getPlane( const int plane ) const
+        {
+            return m_planes[plane];
+        }
+
+        // in Plane order, for ChunkBounds::cull
+        const vec4* getPlanes() const
+        {
+            return m_planes;
+        }
         
         TestResult testIntersection( const vec3 &point ) const;
-        TestResult testIntersection(  BoundingBox box ) const;
+        TestResult testIntersection( const BoundingBox &box ) const;
 
 protected:
 
@@ -132,7 +141,7 @@ Frustum::Frustum( const mat4 &viewMatrix, const mat4 &projectionMatrix ) : Bound
 }
  
 // check whether an AABB intersects the frustum
-BoundingVolume::TestResult Frustum::testIntersection( BoundingBox box ) const
+BoundingVolume::TestResult Frustum::testIntersection( const BoundingBox &box ) const
 {
     TestResult result = TEST_INSIDE;
 
@@ -0,0 +1,314 @@
+#include "cacheFile.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "chunkData.h"
+
+struct CacheFile::Header
+{
+    char magic[4];
+    uint32_t fileVersion;
+    uint32_t generatorVersion;
+    uint32_t numSlots;
+    uint32_t numChunks;
+    uint32_t formatWords[NUM_FORMAT_WORDS];
+    uint32_t padding;
+    uint64_t generatorHash;
+    //bytes of entry data used past dataStart
+    uint64_t dataEnd;
+};
+
+struct CacheFile::Slot
+{
+    int32_t seed;
+    int32_t chunkX;
+    int32_t chunkZ;
+    uint32_t used;
+    //from the start of the file
+    uint64_t offset;
+    uint64_t size;
+    uint64_t checksum;
+};
+
+static size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static uint64_t checksum(const unsigned char* data, size_t size)
+{
+    uint64_t h = size;
+    size_t i = 0;
+    for(; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        h = (h ^ word) * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 29;
+    }
+    for(; i < size; ++i)
+    {
+        h = (h ^ data[i]) * 0x9E3779B97F4A7C15ull;
+    }
+
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 29;
+
+    return h;
+}
+
+static uint32_t hashSlot(int seed, int chunkX, int chunkZ)
+{
+    uint64_t h = (uint32_t)seed;
+    h = h * 0x9E3779B97F4A7C15ull + (uint32_t)chunkX;
+    h = h * 0x9E3779B97F4A7C15ull + (uint32_t)chunkZ;
+
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 29;
+
+    return (uint32_t)h;
+}
+
+CacheFile::CacheFile(const std::string& path, const Format& format, uint64_t generatorHash)
+{
+    this->path = path;
+    this->format = format;
+    this->generatorHash = generatorHash;
+
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    dataStart = alignUp(sizeof(Header) + NUM_SLOTS * sizeof(Slot), pageSize);
+
+    fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if(fd < 0)
+    {
+        reportError("OPEN");
+        return;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || (size_t)info.st_size < dataStart)
+    {
+        reset();
+        return;
+    }
+
+    if(!map(info.st_size))
+    {
+        return;
+    }
+
+    Header* header = getHeader();
+    bool valid = std::memcmp(header->magic, format.magic, sizeof(header->magic)) == 0 &&
+                 header->fileVersion == format.fileVersion &&
+                 header->generatorVersion == ChunkData::GENERATOR_VERSION &&
+                 header->numSlots == NUM_SLOTS &&
+                 std::memcmp(header->formatWords, format.words, sizeof(header->formatWords)) == 0 &&
+                 header->generatorHash == generatorHash;
+
+    if(!valid)
+    {
+        //written by another version of the generator or the cache, none of it can be used
+        reset();
+    }
+    else if(header->dataEnd > mappingSize - dataStart)
+    {
+        //dataEnd comes off the disk too, a damaged one would have store write over the index
+        std::cout << "ERROR::" << format.errorName << "::CORRUPT " << path << std::endl;
+        reset();
+    }
+}
+
+CacheFile::~CacheFile()
+{
+    close();
+}
+
+void CacheFile::reportError(const char* what)
+{
+    std::cout << "ERROR::" << format.errorName << "::" << what << " " << path << ": " << strerror(errno) << std::endl;
+}
+
+void CacheFile::close()
+{
+    if(mapping)
+    {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+
+    if(fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool CacheFile::map(size_t size)
+{
+    if(mapping)
+    {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+    }
+
+    void* result = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(result == MAP_FAILED)
+    {
+        reportError("MMAP");
+        close();
+        return false;
+    }
+
+    mapping = (unsigned char*)result;
+    mappingSize = size;
+
+    return true;
+}
+
+bool CacheFile::reset()
+{
+    //truncating to 0 first zeroes the index, the file stays sparse until entries are written
+    size_t size = dataStart + alignUp(format.growBytes, sysconf(_SC_PAGESIZE));
+    if(ftruncate(fd, 0) != 0 || ftruncate(fd, size) != 0)
+    {
+        reportError("RESIZE");
+        close();
+        return false;
+    }
+
+    if(!map(size))
+    {
+        return false;
+    }
+
+    Header* header = getHeader();
+    std::memcpy(header->magic, format.magic, sizeof(header->magic));
+    header->fileVersion = format.fileVersion;
+    header->generatorVersion = ChunkData::GENERATOR_VERSION;
+    header->numSlots = NUM_SLOTS;
+    header->numChunks = 0;
+    std::memcpy(header->formatWords, format.words, sizeof(header->formatWords));
+    header->padding = 0;
+    header->generatorHash = generatorHash;
+    header->dataEnd = 0;
+
+    return true;
+}
+
+CacheFile::Header* CacheFile::getHeader()
+{
+    return (Header*)mapping;
+}
+
+CacheFile::Slot* CacheFile::getSlots()
+{
+    return (Slot*)(mapping + sizeof(Header));
+}
+
+CacheFile::Slot* CacheFile::findSlot(int seed, int chunkX, int chunkZ)
+{
+    Slot* slots = getSlots();
+
+    //nothing is ever removed, so the first free slot ends the probe
+    uint32_t start = hashSlot(seed, chunkX, chunkZ) % NUM_SLOTS;
+    for(uint32_t i = 0; i < NUM_SLOTS; ++i)
+    {
+        Slot* slot = &slots[(start + i) % NUM_SLOTS];
+        if(!slot->used || (slot->seed == seed && slot->chunkX == chunkX && slot->chunkZ == chunkZ))
+        {
+            return slot;
+        }
+    }
+
+    return nullptr;
+}
+
+bool CacheFile::isIntact(Slot* slot)
+{
+    //offsets and sizes come off the disk, an entry has to be one of the ones written
+    if(getHeader()->dataEnd > mappingSize - dataStart) return false;
+
+    size_t dataEnd = dataStart + getHeader()->dataEnd;
+    if(slot->offset < dataStart || slot->offset > dataEnd || (slot->offset - dataStart) % format.alignment != 0 ||
+       slot->size == 0 || slot->size > dataEnd - slot->offset)
+    {
+        return false;
+    }
+
+    return checksum(mapping + slot->offset, slot->size) == slot->checksum;
+}
+
+const unsigned char* CacheFile::find(int seed, int chunkX, int chunkZ, size_t& size)
+{
+    if(!mapping) return nullptr;
+
+    Slot* slot = findSlot(seed, chunkX, chunkZ);
+    if(!slot || !slot->used || !isIntact(slot)) return nullptr;
+
+    size = slot->size;
+    return mapping + slot->offset;
+}
+
+bool CacheFile::store(int seed, int chunkX, int chunkZ, const unsigned char* data, size_t size)
+{
+    if(!mapping || size == 0) return false;
+
+    Slot* slot = findSlot(seed, chunkX, chunkZ);
+    if(!slot) return false;
+    //a damaged entry is written again and the slot moved onto the new one
+    bool replace = slot->used;
+    if(replace && isIntact(slot)) return true;
+
+    size_t slotIndex = slot - getSlots();
+    size_t offset = dataStart + alignUp(getHeader()->dataEnd, format.alignment);
+
+    if(offset + size > mappingSize)
+    {
+        size_t grow = alignUp(offset + size - mappingSize, sysconf(_SC_PAGESIZE));
+        size_t growBytes = alignUp(format.growBytes, sysconf(_SC_PAGESIZE));
+        size_t newSize = mappingSize + (grow > growBytes ? grow : growBytes);
+        if(ftruncate(fd, newSize) != 0)
+        {
+            reportError("RESIZE");
+            return false;
+        }
+
+        if(!map(newSize))
+        {
+            return false;
+        }
+    }
+
+    std::memcpy(mapping + offset, data, size);
+
+    //nothing orders the pages' writeback, after a crash the slot can be on disk without its entry.
+    //The checksum catches that on find
+    slot = &getSlots()[slotIndex];
+    slot->seed = seed;
+    slot->chunkX = chunkX;
+    slot->chunkZ = chunkZ;
+    slot->offset = offset;
+    slot->size = size;
+    slot->checksum = checksum(mapping + offset, size);
+    slot->used = 1;
+
+    getHeader()->dataEnd = offset + size - dataStart;
+    if(!replace) getHeader()->numChunks++;
+
+    return true;
+}
+
+size_t CacheFile::getNumChunks()
+{
+    return mapping ? getHeader()->numChunks : 0;
+}
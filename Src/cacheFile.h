@@ -0,0 +1,108 @@
+#ifndef CACHE_FILE_H
+#define CACHE_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Memory mapped file of per chunk entries, shared by ChunkCache and CollisionCache.
+//
+// The file starts with a header and a fixed size open addressing index keyed by
+// (seed, chunk x, chunk z), followed by the entries, each aligned as the cache
+// asks. Entries are only ever appended, a chunk stored again after its entry was
+// damaged gets a new one. The header records what the entries were written for:
+// the cache's magic and file version, the generator version and hash, and a few
+// format words of the cache's own. A file that doesn't match is thrown away on open.
+//
+// Everything read back off the disk is bounds checked and every entry is
+// checksummed, so a file cut off by a crash or damaged on disk loses entries
+// instead of handing out garbage or having a store write over the index.
+//
+// Not thread safe, the caches lock around it.
+class CacheFile
+{
+public:
+
+    //words the cache fills with whatever else its entries depend on
+    static const int NUM_FORMAT_WORDS = 2;
+
+    struct Format
+    {
+        char magic[4];
+        uint32_t fileVersion;
+        uint32_t words[NUM_FORMAT_WORDS];
+
+        //every entry starts a multiple of this many bytes past the index
+        size_t alignment;
+        //the file grows in steps of at least this many bytes
+        size_t growBytes;
+
+        //for error messages, ERROR::<errorName>::...
+        const char* errorName;
+    };
+
+    //index entries, the file stops storing once they are all used
+    static const uint32_t NUM_SLOTS = 16384;
+
+private:
+
+    struct Header;
+    struct Slot;
+
+    std::string path;
+
+    Format format;
+    uint64_t generatorHash;
+
+    int fd = -1;
+    unsigned char* mapping = nullptr;
+    size_t mappingSize = 0;
+
+    size_t dataStart;
+
+    Header* getHeader();
+    Slot* getSlots();
+
+    //slot holding the key, or the free slot it would go in. nullptr when the index is full
+    Slot* findSlot(int seed, int chunkX, int chunkZ);
+
+    //whether a used slot's entry lies in the written data and matches its checksum
+    bool isIntact(Slot* slot);
+
+    bool map(size_t size);
+    bool reset();
+    void close();
+
+    void reportError(const char* what);
+
+public:
+
+    // opens or creates the file. On failure it reports why and stays closed,
+    // every find misses and every store is dropped
+    CacheFile(const std::string& path, const Format& format, uint64_t generatorHash);
+    CacheFile(const CacheFile&) = delete;
+    CacheFile& operator=(const CacheFile&) = delete;
+    ~CacheFile();
+
+    bool isOpen()
+    {
+        return mapping != nullptr;
+    }
+
+    // the chunk's entry, nullptr when there is none or it doesn't check out.
+    // Points into the mapping, only valid until the next store
+    const unsigned char* find(int seed, int chunkX, int chunkZ, size_t& size);
+
+    // returns false when the entry couldn't be stored, chunks that already have an intact
+    // entry count as stored and keep it
+    bool store(int seed, int chunkX, int chunkZ, const unsigned char* data, size_t size);
+
+    size_t getNumChunks();
+
+    size_t getFileSize()
+    {
+        return mappingSize;
+    }
+};
+
+#endif
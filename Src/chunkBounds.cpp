@@ -0,0 +1,265 @@
+#include "chunkBounds.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define CHUNK_BOUNDS_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX is picked at runtime, the rest of the build doesn't need -mavx
+#if defined(CHUNK_BOUNDS_SSE2) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CHUNK_BOUNDS_AVX
+#include <immintrin.h>
+#define CHUNK_BOUNDS_AVX_TARGET __attribute__((target("avx")))
+#endif
+
+enum CullLevel { CULL_SCALAR, CULL_SSE2, CULL_AVX };
+
+static CullLevel detectCullLevel()
+{
+#ifdef CHUNK_BOUNDS_AVX
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx"))
+        return CULL_AVX;
+#endif
+#ifdef CHUNK_BOUNDS_SSE2
+    return CULL_SSE2;
+#else
+    return CULL_SCALAR;
+#endif
+}
+
+static CullLevel getCullLevel()
+{
+    static const CullLevel level = detectCullLevel();
+    return level;
+}
+
+const char* ChunkBounds::getInstructionSet()
+{
+    switch(getCullLevel())
+    {
+    case CULL_AVX:
+        return "AVX";
+    case CULL_SSE2:
+        return "SSE2";
+    default:
+        return "scalar";
+    }
+}
+
+void ChunkBounds::clear()
+{
+    minX.clear();
+    minY.clear();
+    minZ.clear();
+    maxX.clear();
+    maxY.clear();
+    maxZ.clear();
+
+    count = 0;
+}
+
+void ChunkBounds::reserve(size_t boxes)
+{
+    size_t padded = (boxes + LANES - 1) / LANES * LANES;
+
+    minX.reserve(padded);
+    minY.reserve(padded);
+    minZ.reserve(padded);
+    maxX.reserve(padded);
+    maxY.reserve(padded);
+    maxZ.reserve(padded);
+}
+
+size_t ChunkBounds::add(glm::vec3 min, glm::vec3 max)
+{
+    //start a new padded batch, its unused boxes are empty and cull skips them
+    if(count == minX.size())
+    {
+        size_t padded = minX.size() + LANES;
+
+        minX.resize(padded, 0.f);
+        minY.resize(padded, 0.f);
+        minZ.resize(padded, 0.f);
+        maxX.resize(padded, 0.f);
+        maxY.resize(padded, 0.f);
+        maxZ.resize(padded, 0.f);
+    }
+
+    minX[count] = min.x;
+    minY[count] = min.y;
+    minZ[count] = min.z;
+    maxX[count] = max.x;
+    maxY[count] = max.y;
+    maxZ[count] = max.z;
+
+    return count++;
+}
+
+void ChunkBounds::remove(size_t index)
+{
+    size_t last = --count;
+
+    minX[index] = minX[last];
+    minY[index] = minY[last];
+    minZ[index] = minZ[last];
+    maxX[index] = maxX[last];
+    maxY[index] = maxY[last];
+    maxZ[index] = maxZ[last];
+
+    //drop the batch once it is empty, boxes past count are never reported anyway
+    if(count % LANES == 0)
+    {
+        minX.resize(count);
+        minY.resize(count);
+        minZ.resize(count);
+        maxX.resize(count);
+        maxY.resize(count);
+        maxZ.resize(count);
+    }
+}
+
+// The corner of a box furthest along a plane's normal is the max on the axes the
+// normal is positive on and the min on the others. That choice is the same for
+// every box, so each plane just picks which arrays to read
+struct CullPlane
+{
+    float nx, ny, nz, d;
+    const float* x;
+    const float* y;
+    const float* z;
+};
+
+static void setupPlanes(const glm::vec4 planes[6], float margin,
+                        const float* minX, const float* minY, const float* minZ,
+                        const float* maxX, const float* maxY, const float* maxZ, CullPlane out[6])
+{
+    for(int p = 0; p < 6; ++p)
+    {
+        const glm::vec4& plane = planes[p];
+
+        out[p].nx = plane.x;
+        out[p].ny = plane.y;
+        out[p].nz = plane.z;
+
+        //growing the box by margin moves its furthest corner that far along every axis
+        out[p].d = plane.w + margin * (std::fabs(plane.x) + std::fabs(plane.y) + std::fabs(plane.z));
+
+        out[p].x = plane.x >= 0.f ? maxX : minX;
+        out[p].y = plane.y >= 0.f ? maxY : minY;
+        out[p].z = plane.z >= 0.f ? maxZ : minZ;
+    }
+}
+
+static void appendVisible(int mask, size_t first, size_t lanes, size_t count, std::vector<uint32_t>& visible)
+{
+    for(size_t lane = 0; lane < lanes; ++lane)
+    {
+        if((mask >> lane & 1) && first + lane < count)
+        {
+            visible.push_back(first + lane);
+        }
+    }
+}
+
+void ChunkBounds::cullScalar(const glm::vec4 planes[6], float margin, std::vector<uint32_t>& visible) const
+{
+    visible.clear();
+
+    CullPlane cullPlanes[6];
+    setupPlanes(planes, margin, minX.data(), minY.data(), minZ.data(), maxX.data(), maxY.data(), maxZ.data(), cullPlanes);
+
+    for(size_t i = 0; i < count; ++i)
+    {
+        bool inside = true;
+        for(int p = 0; p < 6 && inside; ++p)
+        {
+            const CullPlane& plane = cullPlanes[p];
+            inside = plane.nx * plane.x[i] + plane.ny * plane.y[i] + plane.nz * plane.z[i] + plane.d >= 0.f;
+        }
+
+        if(inside) visible.push_back(i);
+    }
+}
+
+#ifdef CHUNK_BOUNDS_SSE2
+static void cullSSE2(const CullPlane planes[6], size_t count, std::vector<uint32_t>& visible)
+{
+    for(size_t i = 0; i < count; i += 4)
+    {
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for(int p = 0; p < 6; ++p)
+        {
+            const CullPlane& plane = planes[p];
+
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+                                  _mm_mul_ps(_mm_set1_ps(plane.nx), _mm_loadu_ps(plane.x + i)),
+                                  _mm_mul_ps(_mm_set1_ps(plane.ny), _mm_loadu_ps(plane.y + i))),
+                                  _mm_mul_ps(_mm_set1_ps(plane.nz), _mm_loadu_ps(plane.z + i))),
+                                  _mm_set1_ps(plane.d));
+
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        if(mask) appendVisible(mask, i, 4, count, visible);
+    }
+}
+#endif
+
+#ifdef CHUNK_BOUNDS_AVX
+CHUNK_BOUNDS_AVX_TARGET
+static void cullAVX(const CullPlane planes[6], size_t count, std::vector<uint32_t>& visible)
+{
+    for(size_t i = 0; i < count; i += 8)
+    {
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for(int p = 0; p < 6; ++p)
+        {
+            const CullPlane& plane = planes[p];
+
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+                                  _mm256_mul_ps(_mm256_set1_ps(plane.nx), _mm256_loadu_ps(plane.x + i)),
+                                  _mm256_mul_ps(_mm256_set1_ps(plane.ny), _mm256_loadu_ps(plane.y + i))),
+                                  _mm256_mul_ps(_mm256_set1_ps(plane.nz), _mm256_loadu_ps(plane.z + i))),
+                                  _mm256_set1_ps(plane.d));
+
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+
+        int mask = _mm256_movemask_ps(inside);
+        if(mask) appendVisible(mask, i, 8, count, visible);
+    }
+}
+#endif
+
+void ChunkBounds::cull(const glm::vec4 planes[6], float margin, std::vector<uint32_t>& visible) const
+{
+    CullLevel level = getCullLevel();
+    if(level == CULL_SCALAR)
+    {
+        cullScalar(planes, margin, visible);
+        return;
+    }
+
+    visible.clear();
+
+    CullPlane cullPlanes[6];
+    setupPlanes(planes, margin, minX.data(), minY.data(), minZ.data(), maxX.data(), maxY.data(), maxZ.data(), cullPlanes);
+
+    //the arrays are padded to LANES, so whole batches can always be read
+#ifdef CHUNK_BOUNDS_AVX
+    if(level == CULL_AVX)
+    {
+        cullAVX(cullPlanes, count, visible);
+        return;
+    }
+#endif
+#ifdef CHUNK_BOUNDS_SSE2
+    cullSSE2(cullPlanes, count, visible);
+#endif
+}
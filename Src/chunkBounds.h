@@ -0,0 +1,69 @@
+#ifndef CHUNK_BOUNDS_H
+#define CHUNK_BOUNDS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Axis aligned boxes of a list of chunks, stored as one array per coordinate so
+// they can be tested 4 (SSE2) or 8 (AVX) at a time. Box i belongs to whatever
+// the caller added as the i-th box, ChunkQuadtree keeps one per bucket of
+// chunks. CPU only
+class ChunkBounds
+{
+private:
+
+    //padded to a multiple of LANES with empty boxes
+    std::vector<float> minX;
+    std::vector<float> minY;
+    std::vector<float> minZ;
+    std::vector<float> maxX;
+    std::vector<float> maxY;
+    std::vector<float> maxZ;
+
+    size_t count = 0;
+
+public:
+
+    //widest batch any code path tests, the arrays are padded to it
+    static const size_t LANES = 8;
+
+    void clear();
+    void reserve(size_t boxes);
+
+    // returns the box's index
+    size_t add(glm::vec3 min, glm::vec3 max);
+
+    // moves the last box into index, like a swap and pop on the caller's list
+    void remove(size_t index);
+
+    glm::vec3 getMin(size_t index) const
+    {
+        return glm::vec3(minX[index], minY[index], minZ[index]);
+    }
+
+    glm::vec3 getMax(size_t index) const
+    {
+        return glm::vec3(maxX[index], maxY[index], maxZ[index]);
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    // indices of the boxes that aren't completely outside one of the planes, in
+    // ascending order. A plane (n, d) keeps points with dot(n, p) + d >= 0, same
+    // as Frustum. Each box is grown by margin on every side first
+    void cull(const glm::vec4 planes[6], float margin, std::vector<uint32_t>& visible) const;
+
+    // same result without SIMD, for comparison
+    void cullScalar(const glm::vec4 planes[6], float margin, std::vector<uint32_t>& visible) const;
+
+    // "AVX", "SSE2" or "scalar", whichever cull uses on this machine
+    static const char* getInstructionSet();
+};
+
+#endif
@@ -0,0 +1,66 @@
+#include "chunkCache.h"
+
+#include <cstring>
+
+#include <unistd.h>
+
+static const char CACHE_MAGIC[4] = { 'T', 'C', 'C', 'H' };
+static const uint32_t CACHE_FILE_VERSION = 3;
+
+ChunkCache::ChunkCache(const std::string& path, const WorldConfig& config)
+{
+    this->config = config;
+
+    //tiles are page aligned so a load only touches its own pages
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t tileSize = (ChunkData::getMemoryUsage(config.terrainSize) + pageSize - 1) / pageSize * pageSize;
+
+    CacheFile::Format format;
+    std::memcpy(format.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    format.fileVersion = CACHE_FILE_VERSION;
+    format.words[0] = tileSize;
+    format.words[1] = 0;
+    format.alignment = tileSize;
+    format.growBytes = GROW_TILES * tileSize;
+    format.errorName = "CHUNK_CACHE";
+
+    file = new CacheFile(path, format, config.getGeneratorHash());
+}
+
+ChunkCache::~ChunkCache()
+{
+    delete file;
+}
+
+ChunkData* ChunkCache::load(int chunkX, int chunkZ)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    size_t size;
+    const unsigned char* tile = file->find(config.seed, chunkX, chunkZ, size);
+    //the size is checked too, the chunk reads as many vertices as the config gives it
+    if(!tile || size != ChunkData::getMemoryUsage(config.terrainSize)) return nullptr;
+
+    return new ChunkData(config, chunkX, chunkZ, (const TerrainVertex*)tile);
+}
+
+bool ChunkCache::store(ChunkData* chunk)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if(chunk->getGeneratorHash() != config.getGeneratorHash()) return false;
+
+    return file->store(chunk->getSeed(), chunk->getChunkX(), chunk->getChunkZ(),
+                       (const unsigned char*)chunk->getVertexBuffer(), chunk->getNumVertices() * sizeof(TerrainVertex));
+}
+
+size_t ChunkCache::getNumChunks()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return file->getNumChunks();
+}
+
+size_t ChunkCache::getFileSize()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return file->getFileSize();
+}
@@ -0,0 +1,64 @@
+#ifndef CHUNK_CACHE_H
+#define CHUNK_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "cacheFile.h"
+#include "chunkData.h"
+#include "worldConfig.h"
+
+// Persistent store of generated chunk vertices, one memory mapped file per world.
+//
+// A CacheFile whose entries are the chunks' packed TerrainVertex data, one page
+// aligned tile each. Loading a chunk that was seen before is a hash lookup and a
+// copy out of the page cache instead of running the noise again. The file is
+// tied to the generator version and the WorldConfig's generator hash, a file
+// written with different ones is thrown away on open. Seeds can share a file.
+//
+// Every tile is checksummed and bounds checked before it is read. A tile that
+// doesn't check out, cut off by a crash or damaged on disk, loads as a miss and
+// is replaced by the next store of that chunk.
+//
+// Safe to use from the generation workers, every call takes the cache's lock.
+class ChunkCache
+{
+private:
+
+    WorldConfig config;
+
+    CacheFile* file;
+
+    std::mutex mutex;
+
+public:
+
+    //grows the file in steps of this many tiles
+    static const size_t GROW_TILES = 64;
+
+    // opens or creates the file. On failure the cache reports why and stays closed,
+    // every load misses and every store is dropped
+    ChunkCache(const std::string& path, const WorldConfig& config);
+    ChunkCache(const ChunkCache&) = delete;
+    ChunkCache& operator=(const ChunkCache&) = delete;
+    ~ChunkCache();
+
+    bool isOpen()
+    {
+        return file->isOpen();
+    }
+
+    // chunk of the config's seed, nullptr when it isn't cached
+    ChunkData* load(int chunkX, int chunkZ);
+
+    // returns false when the chunk couldn't be stored, already cached chunks count as stored.
+    // The chunk has to be generated with the cache's config, the seed may differ
+    bool store(ChunkData* chunk);
+
+    size_t getNumChunks();
+    size_t getFileSize();
+};
+
+#endif
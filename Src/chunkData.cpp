@@ -0,0 +1,334 @@
+#include "chunkData.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "fastnoise/FastNoise.h"
+#include "grassField.h"
+
+static uint64_t mixIdentity(uint64_t h)
+{
+    //splitmix64 finalizer
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBull;
+    h ^= h >> 31;
+
+    return h;
+}
+
+static uint64_t makeIdentity(int seed, uint64_t generatorHash, int chunkPosX, int chunkPosZ)
+{
+    uint64_t h = generatorHash;
+    h = h * 0x9E3779B97F4A7C15ull + (uint32_t)seed;
+    h = h * 0x9E3779B97F4A7C15ull + (uint32_t)chunkPosX;
+    h = h * 0x9E3779B97F4A7C15ull + (uint32_t)chunkPosZ;
+
+    return mixIdentity(h);
+}
+
+uint64_t ChunkData::makeIdentity(const WorldConfig& config, int chunkPosX, int chunkPosZ)
+{
+    return ::makeIdentity(config.seed, config.getGeneratorHash(), chunkPosX, chunkPosZ);
+}
+
+uint64_t ChunkData::getIdentity()
+{
+    return ::makeIdentity(seed, generatorHash, chunkPosX, chunkPosZ);
+}
+
+uint16_t ChunkData::encodeHeight(float height)
+{
+    return (uint16_t)(glm::clamp(height, 0.f, 1.f) * 65535.f + 0.5f);
+}
+
+//nearest snorm8 to a value in [-1, 1], halves round away from 0 like glm::round without the libm call
+static int8_t roundSnorm8(float value)
+{
+    float scaled = glm::clamp(value, -1.f, 1.f) * 127.f;
+    return (int8_t)(scaled >= 0.f ? scaled + 0.5f : scaled - 0.5f);
+}
+
+void ChunkData::encodeNormal(glm::vec3 normal, int8_t* out)
+{
+    //project onto the octahedron |x| + |y| + |z| = 1 and fold the y < 0 half
+    //out over the corners of the [-1, 1]^2 square. The projection scales by the
+    //L1 length, so the normal doesn't have to be unit length
+    normal *= 1.f / (glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z));
+
+    float u = normal.x;
+    float v = normal.z;
+    if(normal.y < 0.f)
+    {
+        u = (1.f - glm::abs(normal.z)) * (normal.x >= 0.f ? 1.f : -1.f);
+        v = (1.f - glm::abs(normal.x)) * (normal.z >= 0.f ? 1.f : -1.f);
+    }
+
+    out[0] = roundSnorm8(u);
+    out[1] = roundSnorm8(v);
+}
+
+int ChunkData::getLineLevel(int line)
+{
+    int level = 0;
+    while(level < TerrainIndexBuffer::MAX_LOD_LEVELS - 1 && (line & 1) == 0)
+    {
+        line >>= 1;
+        level++;
+    }
+
+    return level;
+}
+
+int ChunkData::getVertexLevel(int gridX, int gridZ)
+{
+    //the full resolution edge is shared with the neighbours, it never moves
+    if(gridX == 0 || gridZ == 0 || gridX == terrainSize + 1 || gridZ == terrainSize + 1)
+    {
+        return TerrainIndexBuffer::MAX_LOD_LEVELS;
+    }
+
+    return std::min(getLineLevel(gridX), getLineLevel(gridZ));
+}
+
+//where a grid line falls between two of a coarse level's lines, and how far along.
+//The lines are the same for both axes, so they are found once per level instead of per vertex
+struct LevelLine
+{
+    int lower;
+    int upper;
+    float t;
+};
+
+static void findLevelLines(const std::vector<int>& lines, int gridSize, std::vector<LevelLine>& out)
+{
+    out.resize(gridSize);
+
+    size_t upper = 0;
+    for(int grid = 0; grid < gridSize; ++grid)
+    {
+        while(lines[upper] < grid) upper++;
+        size_t lower = lines[upper] == grid ? upper : upper - 1;
+
+        out[grid].lower = lines[lower];
+        out[grid].upper = lines[upper];
+        out[grid].t = lower == upper ? 0.f : (float)(grid - lines[lower]) / (lines[upper] - lines[lower]);
+    }
+}
+
+//height of a coarse level's surface at a grid point. The coarse cell around the point
+//is split along the same diagonal as the mesh, lower corner to upper corner
+static float sampleLevelHeight(const float* heights, int stride, const LevelLine& x, const LevelLine& z)
+{
+    float h00 = heights[x.lower * stride + z.lower];
+    float h01 = heights[x.lower * stride + z.upper];
+    float h10 = heights[x.upper * stride + z.lower];
+    float h11 = heights[x.upper * stride + z.upper];
+
+    if(z.t >= x.t)
+    {
+        return h00 + z.t * (h01 - h00) + x.t * (h11 - h01);
+    }
+    return h00 + x.t * (h10 - h00) + z.t * (h11 - h10);
+}
+
+void ChunkData::decodePositions(float* out)
+{
+    glm::vec3 origin = getOrigin();
+
+    for(uint32_t i = 0; i < numVertices; ++i)
+    {
+        out[3 * i + 0] = origin.x + vertices[i].gridX;
+        out[3 * i + 1] = decodeHeight(vertices[i].height);
+        out[3 * i + 2] = origin.z + vertices[i].gridZ;
+    }
+}
+
+void ChunkData::generateChunkTerrain(const WorldConfig& config, const FastNoise& noise)
+{
+    //every vertex needs its own height plus the ones at +x and +x+z for the normal,
+    //so sample each grid point exactly once into a (terrainSize + 3)^2 scratch grid
+    const int gridSize = terrainSize + 3;
+    float* heights = new float[gridSize * gridSize]();
+    float* sample = new float[gridSize * gridSize];
+
+    //each octave is evaluated as one batched grid. Heights stay in units of heightScale,
+    //what encodeHeight quantizes, only the normals need them scaled
+    glm::vec3 origin = getOrigin();
+    for(const NoiseOctave& octave : config.octaves)
+    {
+        noise.GetValueGrid(sample, origin.x * octave.scale, origin.z * octave.scale, octave.scale, gridSize, gridSize);
+
+        for(int i = 0; i < gridSize * gridSize; ++i)
+        {
+            heights[i] += ((sample[i] + 1.f) / 2.f) * octave.weight;
+        }
+    }
+
+    delete[] sample;
+
+    const float scale = heightScale;
+
+    const int numLevels = indices->getNumLevels();
+    const int vertexGridSize = terrainSize + 2;
+
+    std::vector<LevelLine> levelLines[TerrainIndexBuffer::MAX_LOD_LEVELS];
+    for(int level = 1; level < numLevels; ++level)
+    {
+        findLevelLines(TerrainIndexBuffer::getLevelLines(terrainSize, level), vertexGridSize, levelLines[level]);
+    }
+
+    //getLineLevel of every grid line, -1 for the full resolution edge that never moves
+    std::vector<int> lineLevels(vertexGridSize);
+    for(int line = 0; line < vertexGridSize; ++line)
+    {
+        lineLevels[line] = line == 0 || line == vertexGridSize - 1 ? -1 : getLineLevel(line);
+    }
+
+    int vertexIndex = 0;
+    for(int i = 0; i < vertexGridSize; ++i)
+    {
+        const float* row = heights + i * gridSize;
+        const float* nextRow = row + gridSize;
+
+        for(int j = 0; j < vertexGridSize; ++j)
+        {
+            float heightA = row[j];
+            float slopeB = (nextRow[j] - heightA) * scale;
+            float slopeC = (nextRow[j + 1] - heightA) * scale;
+
+            TerrainVertex& vertex = vertices[vertexIndex++];
+            vertex.height = encodeHeight(heightA);
+            vertex.gridX = i;
+            vertex.gridZ = j;
+
+            //cross(B - A, C - A) with B - A = (1, slopeB, 0) and C - A = (1, slopeC, 1),
+            //written out so the terms that are always 0 or 1 drop away
+            encodeNormal(glm::vec3(slopeB, -1.f, slopeC - slopeB), vertex.normal);
+
+            //vertices dropped by the next level morph onto its surface, same as getVertexLevel
+            int level = std::min(lineLevels[i], lineLevels[j]);
+            if(level >= 0 && level + 1 < numLevels)
+            {
+                vertex.morphHeight = encodeHeight(sampleLevelHeight(heights, gridSize, levelLines[level + 1][i], levelLines[level + 1][j]));
+            }
+            else
+            {
+                vertex.morphHeight = vertex.height;
+            }
+        }
+    }
+
+    delete[] heights;
+}
+
+void ChunkData::computeBounds()
+{
+    const int gridSize = terrainSize + 2;
+    const int numTiles = getNumTiles(terrainSize);
+
+    glm::vec3 origin = getOrigin();
+
+    uint16_t lowest = 65535;
+    uint16_t highest = 0;
+
+    tileBounds.clear();
+    tileBounds.reserve(numTiles * numTiles);
+    for(int tileX = 0; tileX < numTiles; ++tileX)
+    {
+        for(int tileZ = 0; tileZ < numTiles; ++tileZ)
+        {
+            //tiles share their edge vertices with the neighbours
+            int x0 = tileX * TILE_SIZE;
+            int z0 = tileZ * TILE_SIZE;
+            int x1 = std::min(x0 + TILE_SIZE, gridSize - 1);
+            int z1 = std::min(z0 + TILE_SIZE, gridSize - 1);
+
+            uint16_t low = 65535;
+            uint16_t high = 0;
+            for(int i = x0; i <= x1; ++i)
+            {
+                for(int j = z0; j <= z1; ++j)
+                {
+                    uint16_t height = vertices[i * gridSize + j].height;
+                    low = std::min(low, height);
+                    high = std::max(high, height);
+                }
+            }
+
+            tileBounds.add(glm::vec3(origin.x + x0, decodeHeight(low), origin.z + z0),
+                           glm::vec3(origin.x + x1, decodeHeight(high), origin.z + z1));
+
+            lowest = std::min(lowest, low);
+            highest = std::max(highest, high);
+        }
+    }
+
+    //morph heights are blends of these heights, so they stay inside too
+    worldPosMin = glm::vec3(origin.x, decodeHeight(lowest), origin.z);
+    worldPosMax = glm::vec3(origin.x + gridSize - 1, decodeHeight(highest), origin.z + gridSize - 1);
+}
+
+void ChunkData::init(const WorldConfig& config, int chunkPosX, int chunkPosZ)
+{
+    this->chunkPosX = chunkPosX;
+    this->chunkPosZ = chunkPosZ;
+
+    seed = config.seed;
+    generatorHash = config.getGeneratorHash();
+    terrainSize = config.terrainSize;
+    heightScale = config.heightScale;
+
+    numVertices = (terrainSize + 2) * (terrainSize + 2);
+
+    //this can be quite large so create on heap
+    //NOTE: these get deleted with the chunk
+    vertices = new TerrainVertex[numVertices];
+
+    indices = TerrainIndexBuffer::get(terrainSize);
+}
+
+ChunkData::ChunkData(const WorldConfig& config, const FastNoise& noise, int chunkPosX, int chunkPosZ)
+{   
+    init(config, chunkPosX, chunkPosZ);
+
+    generateChunkTerrain(config, noise);
+    computeBounds();
+}
+
+ChunkData::ChunkData(const WorldConfig& config, int chunkPosX, int chunkPosZ, const TerrainVertex* generated)
+{
+    init(config, chunkPosX, chunkPosZ);
+
+    std::copy(generated, generated + numVertices, vertices);
+    computeBounds();
+}
+
+ChunkData::~ChunkData()
+{
+    delete grass;
+    delete[] vertices;
+}
+
+void ChunkData::scatterGrass(const GrassConfig& config)
+{
+    delete grass;
+    grass = new GrassField(this, config);
+}
+
+void ChunkData::setGrass(GrassField* grass)
+{
+    delete this->grass;
+    this->grass = grass;
+}
+
+size_t ChunkData::getMemoryUsage(int terrainSize)
+{
+    size_t vertexCount = (terrainSize + 2) * (terrainSize + 2);
+
+    return vertexCount * sizeof(TerrainVertex);
+}
+
@@ -0,0 +1,218 @@
+#ifndef CHUNK_DATA_H
+#define CHUNK_DATA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <glm/glm.hpp>
+
+#include "fastnoise/FastNoise.h"
+#include "chunkBounds.h"
+#include "terrainIndexBuffer.h"
+#include "worldConfig.h"
+
+// Packed terrain vertex, 8 bytes instead of the 36 of separate position, normal
+// and color floats. x/z are implied by the vertex's place in the chunk grid and
+// the color is derived from the height, both are rebuilt in terrainPacked.vert
+struct TerrainVertex
+{
+    //height / WorldConfig::heightScale quantized to [0, 65535]
+    uint16_t height;
+
+    //position in the (terrainSize + 2)^2 vertex grid, so terrainSize can be at most 254
+    uint8_t gridX;
+    uint8_t gridZ;
+
+    //octahedral encoded unit normal, snorm8
+    int8_t normal[2];
+
+    //height of the next coarser LOD's surface under this vertex, quantized like height.
+    //the shader blends towards it so the vertex is already in place when the level switches
+    uint16_t morphHeight;
+};
+
+static_assert(sizeof(TerrainVertex) == 8, "TerrainVertex is uploaded as is, keep it tightly packed");
+
+class GrassField;
+
+// The CPU side of a terrain chunk: the generated vertices and everything derived
+// from them. Nothing here needs a GL context, so chunks can be generated, cached
+// and given to physics on any thread or in headless tools. TerrainChunk adds the
+// GPU copy on top of it.
+class ChunkData
+{
+private:
+
+    int chunkPosX;
+    int chunkPosZ;
+
+    //the parts of the WorldConfig the chunk was generated with that are needed after generation
+    int seed;
+    uint64_t generatorHash;
+    int terrainSize;
+    int heightScale;
+
+    //tight around the generated vertices
+    glm::vec3 worldPosMin;
+    glm::vec3 worldPosMax;
+
+    //TILE_SIZE x TILE_SIZE quad tiles, x major
+    ChunkBounds tileBounds;
+
+    uint32_t numVertices;
+
+    TerrainVertex* vertices = nullptr;
+
+    //shared by every chunk of the same size
+    std::shared_ptr<TerrainIndexBuffer> indices;
+
+    GrassField* grass = nullptr;
+
+    //height / heightScale to TerrainVertex::height
+    static uint16_t encodeHeight(float height);
+    //any length normal to TerrainVertex::normal
+    static void encodeNormal(glm::vec3 normal, int8_t* out);
+
+    void generateChunkTerrain(const WorldConfig& config, const FastNoise& noise);
+
+    void init(const WorldConfig& config, int chunkPosX, int chunkPosZ);
+
+    //chunk and tile bounds from the vertex heights, once the vertices are in
+    void computeBounds();
+
+public:
+    //bump whenever generateChunkTerrain would produce different vertices, it invalidates every ChunkCache
+    static const uint32_t GENERATOR_VERSION = 2;
+
+    //quads per side of a tile, the last tile in a row may be smaller
+    static const int TILE_SIZE = 32;
+
+    // noise has to come from config.createNoise()
+    ChunkData(const WorldConfig& config, const FastNoise& noise, int chunkPosX, int chunkPosZ);
+    //from vertices generated earlier with the same config, copies getNumVertices() of them
+    ChunkData(const WorldConfig& config, int chunkPosX, int chunkPosZ, const TerrainVertex* generated);
+    ChunkData(const ChunkData&) = delete;
+    ChunkData& operator=(const ChunkData&) = delete;
+    ~ChunkData();
+
+    // scatters the chunk's grass, replacing any from before. Kept out of the constructors,
+    // the cache doesn't store grass and headless tools may not want it
+    void scatterGrass(const GrassConfig& config);
+
+    // takes ownership of grass scattered elsewhere over this chunk, replacing any from before
+    void setGrass(GrassField* grass);
+
+    // nullptr until scatterGrass or setGrass
+    GrassField* getGrass()
+    {
+        return grass;
+    }
+
+    //bytes held per chunk, used by the streaming budget. The shared index buffer isn't counted
+    static size_t getMemoryUsage(int terrainSize);
+
+    //tiles per side
+    static int getNumTiles(int terrainSize)
+    {
+        return (terrainSize + 1 + TILE_SIZE - 1) / TILE_SIZE;
+    }
+
+    // same config and position always generate the same vertices
+    static uint64_t makeIdentity(const WorldConfig& config, int chunkPosX, int chunkPosZ);
+
+    uint64_t getIdentity();
+
+    int getSeed()
+    {
+        return seed;
+    }
+
+    uint64_t getGeneratorHash()
+    {
+        return generatorHash;
+    }
+
+    int getTerrainSize()
+    {
+        return terrainSize;
+    }
+
+    int getHeightScale()
+    {
+        return heightScale;
+    }
+
+    TerrainVertex* getVertexBuffer()
+    {
+        return vertices;
+    }
+
+    //world position of grid vertex (0, 0), the other vertices are at integer offsets from it
+    glm::vec3 getOrigin()
+    {
+        return glm::vec3(-1 + chunkPosX * (terrainSize + 1), 0, -1 + chunkPosZ * (terrainSize + 1));
+    }
+
+    float decodeHeight(uint16_t height)
+    {
+        return height / 65535.f * heightScale;
+    }
+
+    //coarsest LOD level whose mesh still contains the interior grid line
+    static int getLineLevel(int line);
+    //coarsest LOD level whose mesh contains the vertex, it only morphs while drawn at exactly
+    //this level. Edge vertices are in every level and never morph
+    int getVertexLevel(int gridX, int gridZ);
+
+    //expands the packed vertices to 3 world space floats each, out must hold 3 * getNumVertices()
+    void decodePositions(float* out);
+
+    int getChunkX()
+    {
+        return chunkPosX;
+    }
+
+    int getChunkZ()
+    {
+        return chunkPosZ;
+    }
+
+    glm::vec3 getWorldMin()
+    {
+        return worldPosMin;
+    }
+
+    glm::vec3 getWorldMax()
+    {
+        return worldPosMax;
+    }
+
+    // world bounds of each tile, tile (x, z) is box x * getNumTiles() + z
+    const ChunkBounds& getTileBounds()
+    {
+        return tileBounds;
+    }
+
+    TerrainIndexBuffer* getIndexBuffer()
+    {
+        return indices.get();
+    }
+
+    std::shared_ptr<TerrainIndexBuffer> getSharedIndexBuffer()
+    {
+        return indices;
+    }
+
+    uint32_t getNumVertices()
+    {
+        return numVertices;
+    }
+
+    uint32_t getNumIndices()
+    {
+        return indices->getNumIndices();
+    }
+};
+
+#endif
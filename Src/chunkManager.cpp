@@ -0,0 +1,344 @@
+#include "chunkManager.h"
+
+#include "grassField.h"
+#include "profiler.h"
+#include "threadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+struct ChunkRequest
+{
+    int distance;
+    int x;
+    int z;
+
+    bool operator<(const ChunkRequest& other) const
+    {
+        return distance < other.distance;
+    }
+};
+
+long long ChunkManager::makeKey(int x, int z)
+{
+    return ((long long)x << 32) | (unsigned int)z;
+}
+
+int ChunkManager::worldToChunk(float worldPos)
+{
+    //chunk n spans [n * (terrainSize + 1) - 1, n * (terrainSize + 1) + terrainSize]
+    return (int)std::floor((worldPos + 1.f) / (config.terrainSize + 1));
+}
+
+ChunkManager::ChunkManager(int viewRadius, size_t cpuBudget, size_t gpuBudget, const WorldConfig& config, const std::string& cachePath)
+{
+    this->viewRadius = viewRadius;
+    this->cpuBudget = cpuBudget;
+    this->gpuBudget = gpuBudget;
+
+    centerX = 0;
+    centerZ = 0;
+
+    maxPendingJobs = 2 * ThreadPool::getShared().getNumThreads();
+
+    this->config = config;
+    noise = config.createNoise();
+
+    if(!cachePath.empty())
+    {
+        cache = new ChunkCache(cachePath, config);
+    }
+}
+
+ChunkManager::~ChunkManager()
+{
+    //jobs reference our noise, let them finish first
+    for(auto& pending : pendingChunks)
+    {
+        delete pending.second.get();
+    }
+    pendingChunks.clear();
+
+    for(auto& uploading : uploadingChunks)
+    {
+        delete uploading.second;
+    }
+    uploadingChunks.clear();
+
+    while(!residentChunks.empty())
+    {
+        removeChunk(residentChunks.begin()->first);
+    }
+
+    delete cache;
+}
+
+void ChunkManager::setChunkCallbacks(std::function<void(TerrainChunk*)> onLoaded,
+                                     std::function<void(TerrainChunk*)> onUnloaded)
+{
+    onChunkLoaded = onLoaded;
+    onChunkUnloaded = onUnloaded;
+}
+
+bool ChunkManager::isInRange(int x, int z, int radius)
+{
+    int dx = x - centerX;
+    int dz = z - centerZ;
+
+    return dx * dx + dz * dz <= radius * radius;
+}
+
+size_t ChunkManager::getMaxResidentChunks()
+{
+    //grass is counted at its worst case, the actual blade count isn't known before generating
+    size_t grassUsage = GrassField::getMaxMemoryUsage(config.terrainSize, config.grass);
+
+    return std::min(cpuBudget / (ChunkData::getMemoryUsage(config.terrainSize) + grassUsage),
+                    gpuBudget / (TerrainChunk::getGPUMemoryUsage(config.terrainSize) + grassUsage));
+}
+
+ChunkData* ChunkManager::loadChunk(int x, int z, bool withGrass)
+{
+    PROFILE_SCOPE("load chunk");
+
+    ChunkData* data = cache ? cache->load(x, z) : nullptr;
+    if(!data)
+    {
+        data = new ChunkData(config, noise, x, z);
+        if(cache) cache->store(data);
+    }
+
+    if(withGrass) data->scatterGrass(config.grass);
+
+    return data;
+}
+
+void ChunkManager::startUpload(ChunkData* data)
+{
+    TerrainChunk* chunk = new TerrainChunk(data);
+
+    uploadingChunks[makeKey(chunk->getChunkX(), chunk->getChunkZ())] = chunk;
+    uploadQueue.push(chunk);
+}
+
+void ChunkManager::addChunks(const std::vector<TerrainChunk*>& uploaded)
+{
+    for(TerrainChunk* chunk : uploaded)
+    {
+        long long key = makeKey(chunk->getChunkX(), chunk->getChunkZ());
+
+        uploadingChunks.erase(key);
+        residentChunks[key] = chunk;
+        chunks.push_back(chunk);
+        quadtree.insert(chunk, chunk->getChunkX(), chunk->getChunkZ(), chunk->getWorldMin(), chunk->getWorldMax());
+
+        if(onChunkLoaded) onChunkLoaded(chunk);
+    }
+}
+
+void ChunkManager::removeChunk(long long key)
+{
+    auto it = residentChunks.find(key);
+    TerrainChunk* chunk = it->second;
+
+    //the grass job reads the chunk's data
+    auto grass = pendingGrass.find(key);
+    if(grass != pendingGrass.end())
+    {
+        delete grass->second.get();
+        pendingGrass.erase(grass);
+    }
+
+    if(onChunkUnloaded) onChunkUnloaded(chunk);
+
+    chunks.erase(std::find(chunks.begin(), chunks.end(), chunk));
+    quadtree.remove(chunk->getChunkX(), chunk->getChunkZ());
+    residentChunks.erase(it);
+
+    delete chunk;
+}
+
+void ChunkManager::loadSpawn(glm::vec3 position, int radius)
+{
+    centerX = worldToChunk(position.x);
+    centerZ = worldToChunk(position.z);
+
+    ThreadPool& pool = ThreadPool::getShared();
+
+    std::vector<std::future<ChunkData*>> futures;
+    for(int x = centerX - radius; x <= centerX + radius; ++x)
+    {
+        for(int z = centerZ - radius; z <= centerZ + radius; ++z)
+        {
+            long long key = makeKey(x, z);
+            if(!isInRange(x, z, radius) || residentChunks.count(key) || pendingChunks.count(key) || uploadingChunks.count(key)) continue;
+
+            //grass is left for later, it takes longer than the terrain
+            futures.push_back(pool.submit([this, x, z]
+            {
+                return loadChunk(x, z, false);
+            }));
+        }
+    }
+
+    for(size_t i = 0; i < futures.size(); ++i)
+    {
+        startUpload(futures[i].get());
+    }
+
+    //no budget here, the player needs the ground right away
+    std::vector<TerrainChunk*> uploaded;
+    uploadQueue.flush(uploaded);
+    addChunks(uploaded);
+
+    //the flush can also finish streamed chunks, those came with their grass
+    for(TerrainChunk* chunk : uploaded)
+    {
+        ChunkData* data = chunk->getData();
+        if(data->getGrass()) continue;
+
+        pendingGrass[makeKey(chunk->getChunkX(), chunk->getChunkZ())] = pool.submit([this, data]
+        {
+            return new GrassField(data, config.grass);
+        });
+    }
+}
+
+bool ChunkManager::update(glm::vec3 position)
+{
+    bool changed = false;
+
+    centerX = worldToChunk(position.x);
+    centerZ = worldToChunk(position.z);
+
+    //grass for the spawn chunks, they stay resident until it is picked up or waited on
+    for(auto it = pendingGrass.begin(); it != pendingGrass.end();)
+    {
+        if(it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++it;
+            continue;
+        }
+
+        residentChunks[it->first]->addGrass(it->second.get());
+        it = pendingGrass.erase(it);
+    }
+
+    //pick up finished jobs, the player may have moved on while they ran
+    for(auto it = pendingChunks.begin(); it != pendingChunks.end();)
+    {
+        if(it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++it;
+            continue;
+        }
+
+        ChunkData* data = it->second.get();
+        if(isInRange(data->getChunkX(), data->getChunkZ(), viewRadius + 1))
+        {
+            startUpload(data);
+        }
+        else
+        {
+            delete data;
+        }
+
+        it = pendingChunks.erase(it);
+    }
+
+    //at most the queue's byte budget per frame, bigger backlogs finish over the next frames
+    std::vector<TerrainChunk*> uploaded;
+    uploadQueue.update(uploaded);
+    addChunks(uploaded);
+    changed = changed || !uploaded.empty();
+
+    for(auto it = uploadingChunks.begin(); it != uploadingChunks.end();)
+    {
+        TerrainChunk* chunk = it->second;
+        if(isInRange(chunk->getChunkX(), chunk->getChunkZ(), viewRadius + 1))
+        {
+            ++it;
+            continue;
+        }
+
+        uploadQueue.cancel(chunk);
+        delete chunk;
+        it = uploadingChunks.erase(it);
+    }
+
+    //retire with one chunk of slack so walking back and forth over a
+    //border doesn't keep regenerating the same chunks
+    std::vector<long long> retired;
+    for(auto& resident : residentChunks)
+    {
+        TerrainChunk* chunk = resident.second;
+        if(!isInRange(chunk->getChunkX(), chunk->getChunkZ(), viewRadius + 1))
+        {
+            retired.push_back(resident.first);
+        }
+    }
+
+    //uploading chunks already hold their GL storage, so they count against the budget
+    size_t maxResident = getMaxResidentChunks();
+    maxResident -= std::min(maxResident, uploadingChunks.size());
+    if(residentChunks.size() - retired.size() > maxResident)
+    {
+        //still over budget, drop the farthest of the remaining chunks
+        std::vector<ChunkRequest> byDistance;
+        for(auto& resident : residentChunks)
+        {
+            int dx = resident.second->getChunkX() - centerX;
+            int dz = resident.second->getChunkZ() - centerZ;
+            if(std::find(retired.begin(), retired.end(), resident.first) != retired.end()) continue;
+
+            byDistance.push_back({ dx * dx + dz * dz, resident.second->getChunkX(), resident.second->getChunkZ() });
+        }
+        std::sort(byDistance.begin(), byDistance.end());
+
+        for(size_t i = maxResident; i < byDistance.size(); ++i)
+        {
+            retired.push_back(makeKey(byDistance[i].x, byDistance[i].z));
+        }
+    }
+
+    for(long long key : retired)
+    {
+        removeChunk(key);
+        changed = true;
+    }
+
+    if(pendingChunks.size() >= maxPendingJobs) return changed;
+
+    //queue the missing chunks closest first
+    std::vector<ChunkRequest> missing;
+    for(int x = centerX - viewRadius; x <= centerX + viewRadius; ++x)
+    {
+        for(int z = centerZ - viewRadius; z <= centerZ + viewRadius; ++z)
+        {
+            long long key = makeKey(x, z);
+            if(!isInRange(x, z, viewRadius) || residentChunks.count(key) || pendingChunks.count(key) || uploadingChunks.count(key)) continue;
+
+            int dx = x - centerX;
+            int dz = z - centerZ;
+            missing.push_back({ dx * dx + dz * dz, x, z });
+        }
+    }
+    std::sort(missing.begin(), missing.end());
+
+    ThreadPool& pool = ThreadPool::getShared();
+    for(const ChunkRequest& request : missing)
+    {
+        if(pendingChunks.size() >= maxPendingJobs) break;
+        if(residentChunks.size() + pendingChunks.size() >= maxResident) break;
+
+        int x = request.x;
+        int z = request.z;
+        pendingChunks[makeKey(x, z)] = pool.submit([this, x, z]
+        {
+            return loadChunk(x, z, true);
+        });
+    }
+
+    return changed;
+}
@@ -0,0 +1,121 @@
+#ifndef CHUNK_MANAGER_H
+#define CHUNK_MANAGER_H
+
+#include <functional>
+#include <string>
+#include <future>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "fastnoise/FastNoise.h"
+#include "chunkCache.h"
+#include "chunkData.h"
+#include "chunkQuadtree.h"
+#include "terrainChunk.h"
+#include "terrainUploadQueue.h"
+#include "worldConfig.h"
+
+class GrassField;
+
+// Streams terrain around a moving point. Chunks within viewRadius (in chunks) of
+// the center are generated on the shared thread pool and handed to the upload
+// queue as they finish, they become resident once their data is on the GPU.
+// The GL side only ever runs in update. Chunks that fall behind are retired.
+// The resident set never grows past the memory budgets, the closest chunks win
+// when it would.
+class ChunkManager
+{
+private:
+
+    int viewRadius;
+
+    size_t cpuBudget;
+    size_t gpuBudget;
+
+    //only this many jobs are queued at once so a teleport doesn't flood the pool
+    size_t maxPendingJobs;
+
+    WorldConfig config;
+    FastNoise noise;
+
+    //chunks seen in earlier runs load from here instead of being generated, may be null
+    ChunkCache* cache = nullptr;
+
+    std::unordered_map<long long, TerrainChunk*> residentChunks;
+    std::unordered_map<long long, std::future<ChunkData*>> pendingChunks;
+
+    //grass of resident chunks that were loaded without it, the jobs read the chunk's data
+    std::unordered_map<long long, std::future<GrassField*>> pendingGrass;
+
+    //generated, waiting for their data to reach the GPU
+    std::unordered_map<long long, TerrainChunk*> uploadingChunks;
+    TerrainUploadQueue uploadQueue;
+
+    std::vector<TerrainChunk*> chunks;
+    ChunkQuadtree<TerrainChunk*> quadtree;
+
+    int centerX;
+    int centerZ;
+
+    std::function<void(TerrainChunk*)> onChunkLoaded;
+    std::function<void(TerrainChunk*)> onChunkUnloaded;
+
+    static long long makeKey(int x, int z);
+
+    bool isInRange(int x, int z, int radius);
+    size_t getMaxResidentChunks();
+
+    //runs on the pool
+    ChunkData* loadChunk(int x, int z, bool withGrass);
+
+    void startUpload(ChunkData* data);
+    //chunks that came out of the upload queue
+    void addChunks(const std::vector<TerrainChunk*>& uploaded);
+    void removeChunk(long long key);
+
+public:
+
+    // without a cachePath every chunk is generated from noise
+    ChunkManager(int viewRadius, size_t cpuBudget, size_t gpuBudget, const WorldConfig& config, const std::string& cachePath = "");
+    ~ChunkManager();
+
+    // called on the main thread whenever a chunk becomes resident (after it is on the GPU)
+    // and right before a chunk is deleted
+    void setChunkCallbacks(std::function<void(TerrainChunk*)> onLoaded,
+                           std::function<void(TerrainChunk*)> onUnloaded);
+
+    // synchronously generates the chunks directly around position, so the
+    // player has ground to stand on before the first frame. Their grass is
+    // scattered on the pool afterwards and shows up in a later update
+    void loadSpawn(glm::vec3 position, int radius = 1);
+
+    // returns true when the resident set changed
+    bool update(glm::vec3 position);
+
+    const std::vector<TerrainChunk*>& getChunks()
+    {
+        return chunks;
+    }
+
+    // the resident chunks by position, for culling and nearest or radius queries
+    const ChunkQuadtree<TerrainChunk*>& getQuadtree()
+    {
+        return quadtree;
+    }
+
+    size_t getNumPendingChunks()
+    {
+        return pendingChunks.size();
+    }
+
+    size_t getNumUploadingChunks()
+    {
+        return uploadingChunks.size();
+    }
+
+    int worldToChunk(float worldPos);
+};
+
+#endif
@@ -0,0 +1,447 @@
+#ifndef CHUNK_QUADTREE_H
+#define CHUNK_QUADTREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "chunkBounds.h"
+
+// Resident chunks by chunk coordinates. A node on level L covers 2^L x 2^L
+// chunks and keeps the bounds of every chunk under it, so queries reject whole
+// subtrees at once. Nodes on BUCKET_LEVEL hold the chunks themselves, their
+// boxes go in a ChunkBounds and get culled with SIMD. Roots are on ROOT_LEVEL
+// and created wherever there are chunks, so the world has no fixed extent.
+// Nodes only exist while they have chunks under them.
+//
+// Chunk is whatever the caller wants back from the queries, ChunkManager
+// stores TerrainChunk*. Not thread safe
+template<typename Chunk>
+class ChunkQuadtree
+{
+public:
+
+    //8x8 chunks per bucket, 1024x1024 per root
+    static const int BUCKET_LEVEL = 3;
+    static const int ROOT_LEVEL = 10;
+
+private:
+
+    struct Entry
+    {
+        Chunk chunk;
+        int x;
+        int z;
+    };
+
+    struct Node
+    {
+        int level;
+        int x;
+        int z;
+
+        //only meaningful while numChunks > 0
+        glm::vec3 min;
+        glm::vec3 max;
+        size_t numChunks = 0;
+
+        Node* parent;
+        Node* children[4] = {};
+
+        //BUCKET_LEVEL only, entries[i] has box i
+        ChunkBounds bounds;
+        std::vector<Entry> entries;
+    };
+
+    enum BoxTest { BOX_OUTSIDE, BOX_INTERSECTS, BOX_INSIDE };
+
+    std::unordered_map<long long, Node*> roots;
+    size_t count = 0;
+
+    //bucket results of cull, only used while it runs
+    mutable std::vector<uint32_t> bucketVisible;
+
+    static long long makeKey(int x, int z)
+    {
+        return ((long long)x << 32) | (unsigned int)z;
+    }
+
+    // coordinate on level of the node containing chunk, rounds down for negative chunks too
+    static int toNode(int chunk, int level)
+    {
+        return chunk >= 0 ? chunk >> level : ~(~chunk >> level);
+    }
+
+    static int getChildIndex(const Node* node, int x, int z)
+    {
+        int childX = toNode(x, node->level - 1);
+        int childZ = toNode(z, node->level - 1);
+
+        return (childX - 2 * node->x) + 2 * (childZ - 2 * node->z);
+    }
+
+    static float getDistance2(glm::vec3 pos, glm::vec3 min, glm::vec3 max)
+    {
+        glm::vec3 d = glm::max(glm::max(min - pos, glm::vec3(0.f)), pos - max);
+        return glm::dot(d, d);
+    }
+
+    //distance of the box's footprint
+    static float getDistance2XZ(glm::vec3 pos, glm::vec3 min, glm::vec3 max)
+    {
+        pos.y = glm::clamp(pos.y, min.y, max.y);
+        return getDistance2(pos, min, max);
+    }
+
+    // same plane convention as Frustum and ChunkBounds
+    static BoxTest testBox(const glm::vec4 planes[6], glm::vec3 min, glm::vec3 max)
+    {
+        BoxTest result = BOX_INSIDE;
+        for(int p = 0; p < 6; ++p)
+        {
+            glm::vec3 normal(planes[p]);
+
+            //corners furthest along and against the normal
+            glm::vec3 positive(normal.x >= 0.f ? max.x : min.x, normal.y >= 0.f ? max.y : min.y, normal.z >= 0.f ? max.z : min.z);
+            glm::vec3 negative(normal.x >= 0.f ? min.x : max.x, normal.y >= 0.f ? min.y : max.y, normal.z >= 0.f ? min.z : max.z);
+
+            if(glm::dot(normal, positive) + planes[p].w < 0.f) return BOX_OUTSIDE;
+            if(glm::dot(normal, negative) + planes[p].w < 0.f) result = BOX_INTERSECTS;
+        }
+
+        return result;
+    }
+
+    static void include(Node* node, glm::vec3 min, glm::vec3 max)
+    {
+        if(node->numChunks == 0)
+        {
+            node->min = min;
+            node->max = max;
+        }
+        else
+        {
+            node->min = glm::min(node->min, min);
+            node->max = glm::max(node->max, max);
+        }
+
+        node->numChunks++;
+    }
+
+    // recomputes the bounds after a chunk under node went away
+    static void refit(Node* node)
+    {
+        bool first = true;
+        if(node->level == BUCKET_LEVEL)
+        {
+            for(size_t i = 0; i < node->bounds.size(); ++i)
+            {
+                node->min = first ? node->bounds.getMin(i) : glm::min(node->min, node->bounds.getMin(i));
+                node->max = first ? node->bounds.getMax(i) : glm::max(node->max, node->bounds.getMax(i));
+                first = false;
+            }
+            return;
+        }
+
+        for(Node* child : node->children)
+        {
+            if(!child) continue;
+
+            node->min = first ? child->min : glm::min(node->min, child->min);
+            node->max = first ? child->max : glm::max(node->max, child->max);
+            first = false;
+        }
+    }
+
+    static void deleteNode(Node* node)
+    {
+        for(Node* child : node->children)
+        {
+            if(child) deleteNode(child);
+        }
+
+        delete node;
+    }
+
+    static void appendAll(const Node* node, std::vector<Chunk>& out)
+    {
+        if(node->level == BUCKET_LEVEL)
+        {
+            for(const Entry& entry : node->entries)
+            {
+                out.push_back(entry.chunk);
+            }
+            return;
+        }
+
+        for(const Node* child : node->children)
+        {
+            if(child) appendAll(child, out);
+        }
+    }
+
+    void cullNode(const Node* node, const glm::vec4 planes[6], float margin, std::vector<Chunk>& visible) const
+    {
+        BoxTest test = testBox(planes, node->min - glm::vec3(margin), node->max + glm::vec3(margin));
+        if(test == BOX_OUTSIDE) return;
+
+        if(test == BOX_INSIDE)
+        {
+            appendAll(node, visible);
+            return;
+        }
+
+        if(node->level == BUCKET_LEVEL)
+        {
+            node->bounds.cull(planes, margin, bucketVisible);
+            for(uint32_t index : bucketVisible)
+            {
+                visible.push_back(node->entries[index].chunk);
+            }
+            return;
+        }
+
+        for(const Node* child : node->children)
+        {
+            if(child) cullNode(child, planes, margin, visible);
+        }
+    }
+
+    static void findNearest(const Node* node, glm::vec3 pos, float& best, const Chunk*& nearest)
+    {
+        if(node->level == BUCKET_LEVEL)
+        {
+            for(size_t i = 0; i < node->entries.size(); ++i)
+            {
+                float distance = getDistance2(pos, node->bounds.getMin(i), node->bounds.getMax(i));
+                if(distance < best)
+                {
+                    best = distance;
+                    nearest = &node->entries[i].chunk;
+                }
+            }
+            return;
+        }
+
+        //closest child first, it usually leaves nothing to look at in the others
+        const Node* children[4];
+        float distances[4];
+        int numChildren = 0;
+        for(const Node* child : node->children)
+        {
+            if(!child) continue;
+
+            float distance = getDistance2(pos, child->min, child->max);
+
+            int i = numChildren++;
+            for(; i > 0 && distances[i - 1] > distance; --i)
+            {
+                children[i] = children[i - 1];
+                distances[i] = distances[i - 1];
+            }
+            children[i] = child;
+            distances[i] = distance;
+        }
+
+        for(int i = 0; i < numChildren && distances[i] < best; ++i)
+        {
+            findNearest(children[i], pos, best, nearest);
+        }
+    }
+
+    template<float (*distance2)(glm::vec3, glm::vec3, glm::vec3)>
+    static void findInRadius(const Node* node, glm::vec3 pos, float radius2, std::vector<Chunk>& found)
+    {
+        if(distance2(pos, node->min, node->max) > radius2) return;
+
+        if(node->level == BUCKET_LEVEL)
+        {
+            for(size_t i = 0; i < node->entries.size(); ++i)
+            {
+                if(distance2(pos, node->bounds.getMin(i), node->bounds.getMax(i)) <= radius2)
+                {
+                    found.push_back(node->entries[i].chunk);
+                }
+            }
+            return;
+        }
+
+        for(const Node* child : node->children)
+        {
+            if(child) findInRadius<distance2>(child, pos, radius2, found);
+        }
+    }
+
+public:
+
+    ChunkQuadtree() = default;
+    ChunkQuadtree(const ChunkQuadtree&) = delete;
+    ChunkQuadtree& operator=(const ChunkQuadtree&) = delete;
+
+    ~ChunkQuadtree()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        for(auto& root : roots)
+        {
+            deleteNode(root.second);
+        }
+        roots.clear();
+
+        count = 0;
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    // min and max are the chunk's world bounds, there can only be one chunk at x, z
+    void insert(Chunk chunk, int x, int z, glm::vec3 min, glm::vec3 max)
+    {
+        Node*& root = roots[makeKey(toNode(x, ROOT_LEVEL), toNode(z, ROOT_LEVEL))];
+        if(!root)
+        {
+            root = new Node();
+            root->level = ROOT_LEVEL;
+            root->x = toNode(x, ROOT_LEVEL);
+            root->z = toNode(z, ROOT_LEVEL);
+            root->parent = nullptr;
+        }
+
+        Node* node = root;
+        while(node->level > BUCKET_LEVEL)
+        {
+            include(node, min, max);
+
+            Node*& child = node->children[getChildIndex(node, x, z)];
+            if(!child)
+            {
+                child = new Node();
+                child->level = node->level - 1;
+                child->x = toNode(x, child->level);
+                child->z = toNode(z, child->level);
+                child->parent = node;
+            }
+
+            node = child;
+        }
+
+        include(node, min, max);
+        node->bounds.add(min, max);
+        node->entries.push_back({ chunk, x, z });
+
+        count++;
+    }
+
+    // returns false when there is no chunk at x, z
+    bool remove(int x, int z)
+    {
+        auto root = roots.find(makeKey(toNode(x, ROOT_LEVEL), toNode(z, ROOT_LEVEL)));
+        if(root == roots.end()) return false;
+
+        Node* node = root->second;
+        while(node && node->level > BUCKET_LEVEL)
+        {
+            node = node->children[getChildIndex(node, x, z)];
+        }
+        if(!node) return false;
+
+        size_t index = 0;
+        while(index < node->entries.size() && (node->entries[index].x != x || node->entries[index].z != z))
+        {
+            index++;
+        }
+        if(index == node->entries.size()) return false;
+
+        node->entries[index] = node->entries.back();
+        node->entries.pop_back();
+        node->bounds.remove(index);
+
+        count--;
+
+        //shrink the bounds on the way up, nodes left empty go away
+        while(node)
+        {
+            Node* parent = node->parent;
+
+            if(--node->numChunks > 0)
+            {
+                refit(node);
+            }
+            else
+            {
+                if(parent) parent->children[getChildIndex(parent, x, z)] = nullptr;
+                else roots.erase(root);
+
+                delete node;
+            }
+
+            node = parent;
+        }
+
+        return true;
+    }
+
+    // chunks whose bounds, grown by margin on every side, aren't completely
+    // outside one of the planes. A plane (n, d) keeps points with dot(n, p) + d >= 0,
+    // same as Frustum. Nodes entirely inside are added without testing their chunks
+    void cull(const glm::vec4 planes[6], float margin, std::vector<Chunk>& visible) const
+    {
+        visible.clear();
+
+        for(auto& root : roots)
+        {
+            cullNode(root.second, planes, margin, visible);
+        }
+    }
+
+    // chunk whose bounds are closest to pos, false when the tree is empty
+    bool findNearest(glm::vec3 pos, Chunk& nearest) const
+    {
+        float best = 1e30f;
+        const Chunk* found = nullptr;
+
+        for(auto& root : roots)
+        {
+            if(getDistance2(pos, root.second->min, root.second->max) < best)
+            {
+                findNearest(root.second, pos, best, found);
+            }
+        }
+
+        if(!found) return false;
+
+        nearest = *found;
+        return true;
+    }
+
+    // chunks whose bounds are at most radius from pos
+    void findInRadius(glm::vec3 pos, float radius, std::vector<Chunk>& found) const
+    {
+        found.clear();
+
+        for(auto& root : roots)
+        {
+            findInRadius<getDistance2>(root.second, pos, radius * radius, found);
+        }
+    }
+
+    // chunks whose x/z footprint is at most radius from pos, at any height.
+    // Appends to found
+    void findInColumn(glm::vec3 pos, float radius, std::vector<Chunk>& found) const
+    {
+        for(auto& root : roots)
+        {
+            findInRadius<getDistance2XZ>(root.second, pos, radius * radius, found);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,66 @@
+#include "collisionCache.h"
+
+#include <cstring>
+
+static const char CACHE_MAGIC[4] = { 'T', 'B', 'V', 'H' };
+static const uint32_t CACHE_FILE_VERSION = 3;
+
+//deSerializeInPlace reads the BVH straight out of the buffer it is given
+static const size_t ENTRY_ALIGNMENT = 16;
+
+CollisionCache::CollisionCache(const std::string& path, const WorldConfig& config)
+{
+    this->config = config;
+
+    //BVHs laid out by another build of Bullet can't be read back
+    CacheFile::Format format;
+    std::memcpy(format.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    format.fileVersion = CACHE_FILE_VERSION;
+    format.words[0] = BT_BULLET_VERSION;
+    format.words[1] = sizeof(btScalar);
+    format.alignment = ENTRY_ALIGNMENT;
+    format.growBytes = GROW_BYTES;
+    format.errorName = "COLLISION_CACHE";
+
+    file = new CacheFile(path, format, config.getGeneratorHash());
+}
+
+CollisionCache::~CollisionCache()
+{
+    delete file;
+}
+
+bool CollisionCache::load(int chunkX, int chunkZ, btAlignedObjectArray<unsigned char>& bvh)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    size_t size;
+    const unsigned char* entry = file->find(config.seed, chunkX, chunkZ, size);
+    if(!entry || size > INT32_MAX) return false;
+
+    //copied out, a store on another thread can move the mapping while the BVH is in use
+    bvh.resize((int)size);
+    std::memcpy(&bvh[0], entry, size);
+
+    return true;
+}
+
+bool CollisionCache::store(ChunkData* chunk, const unsigned char* bvh, size_t size)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if(chunk->getGeneratorHash() != config.getGeneratorHash()) return false;
+
+    return file->store(chunk->getSeed(), chunk->getChunkX(), chunk->getChunkZ(), bvh, size);
+}
+
+size_t CollisionCache::getNumChunks()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return file->getNumChunks();
+}
+
+size_t CollisionCache::getFileSize()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return file->getFileSize();
+}
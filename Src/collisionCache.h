@@ -0,0 +1,71 @@
+#ifndef COLLISION_CACHE_H
+#define COLLISION_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include <bullet/btBulletDynamicsCommon.h>
+
+#include "cacheFile.h"
+#include "chunkData.h"
+#include "worldConfig.h"
+
+// Persistent store of terrain collision BVHs, the counterpart of ChunkCache for
+// physics and kept in a file next to it.
+//
+// A CacheFile whose entries are quantized btOptimizedBvhs in Bullet's in place
+// serialization format, ready for btOptimizedBvh::deSerializeInPlace, so a chunk
+// seen before gets its collision mesh back without building the BVH again. The
+// tree's size depends on its shape, so entries are variable length, each 16 byte
+// aligned the way Bullet wants them. Besides the generator version and hash the
+// file is tied to the Bullet version and scalar size the BVHs were written with,
+// a file that doesn't match is thrown away on open.
+//
+// deSerializeInPlace trusts the counts and offsets inside the BVH, so every
+// entry is bounds checked and checksummed before it is handed out. An entry
+// that doesn't check out, cut off by a crash or damaged on disk, loads as a
+// miss and is replaced by the next store of that chunk.
+//
+// Safe to use from the collision workers, every call takes the cache's lock.
+class CollisionCache
+{
+private:
+
+    WorldConfig config;
+
+    CacheFile* file;
+
+    std::mutex mutex;
+
+public:
+
+    //grows the file in steps of at least this many bytes
+    static const size_t GROW_BYTES = 16 << 20;
+
+    // opens or creates the file. On failure the cache reports why and stays closed,
+    // every load misses and every store is dropped
+    CollisionCache(const std::string& path, const WorldConfig& config);
+    CollisionCache(const CollisionCache&) = delete;
+    CollisionCache& operator=(const CollisionCache&) = delete;
+    ~CollisionCache();
+
+    bool isOpen()
+    {
+        return file->isOpen();
+    }
+
+    // copies the serialized BVH of a chunk of the config's seed into bvh, sized to fit.
+    // Returns false when it isn't cached
+    bool load(int chunkX, int chunkZ, btAlignedObjectArray<unsigned char>& bvh);
+
+    // returns false when the BVH couldn't be stored, already cached chunks count as stored.
+    // The BVH has to be serialized from the chunk's collision mesh
+    bool store(ChunkData* chunk, const unsigned char* bvh, size_t size);
+
+    size_t getNumChunks();
+    size_t getFileSize();
+};
+
+#endif
@@ -30,8 +30,10 @@
 
 #include <math.h>
 #include <assert.h>
+#include <string.h>
 
 #include <algorithm>
+#include <atomic>
 #include <random>
 
 const FN_DECIMAL GRAD_X[] =
@@ -2248,3 +2250,598 @@ void FastNoise::SingleGradientPerturb(unsigned char offset, FN_DECIMAL warpAmp,
 	x += Lerp(lx0x, lx1x, ys) * warpAmp;
 	y += Lerp(ly0x, ly1x, ys) * warpAmp;
 }
+
+// Batched grid evaluation
+//
+// The grid functions evaluate the same points as calling the scalar functions
+// with (xStart + xi * step, yStart + yi * step), 4 (SSE2) or 8 (AVX2) y values
+// at a time. Every lane performs the same operations in the same order as the
+// scalar code, so results match it. Permutation and gradient lookups are done
+// per lane with SSE2 and with gathers on AVX2.
+
+#if !defined(FN_USE_DOUBLES) && (defined(__SSE2__) || defined(_M_X64))
+#define FN_GRID_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(FN_GRID_SSE2) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FN_GRID_AVX2
+#include <immintrin.h>
+#define FN_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+enum GridLevel { GRID_SCALAR, GRID_SSE2, GRID_AVX2 };
+
+static GridLevel DetectGridLevel()
+{
+#ifdef FN_GRID_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return GRID_AVX2;
+#endif
+#ifdef FN_GRID_SSE2
+	return GRID_SSE2;
+#else
+	return GRID_SCALAR;
+#endif
+}
+
+// -1 until SetGridInstructionSet forces a level. Atomic, the grid functions read it on the pool workers
+static std::atomic<int> g_forcedGridLevel(-1);
+
+static GridLevel GetGridLevel()
+{
+	static const GridLevel level = DetectGridLevel();
+	int forced = g_forcedGridLevel.load(std::memory_order_relaxed);
+	if (forced >= 0)
+		return (GridLevel)forced;
+	return level;
+}
+
+bool FastNoise::SetGridInstructionSet(const char* name)
+{
+	if (!name)
+	{
+		g_forcedGridLevel = -1;
+		return true;
+	}
+
+	if (!strcmp(name, "scalar"))
+	{
+		g_forcedGridLevel = GRID_SCALAR;
+		return true;
+	}
+
+#ifdef FN_GRID_SSE2
+	if (!strcmp(name, "SSE2"))
+	{
+		g_forcedGridLevel = GRID_SSE2;
+		return true;
+	}
+#endif
+
+#ifdef FN_GRID_AVX2
+	if (!strcmp(name, "AVX2") && DetectGridLevel() == GRID_AVX2)
+	{
+		g_forcedGridLevel = GRID_AVX2;
+		return true;
+	}
+#endif
+
+	return false;
+}
+
+const char* FastNoise::GetGridInstructionSet()
+{
+	switch (GetGridLevel())
+	{
+	case GRID_AVX2:
+		return "AVX2";
+	case GRID_SSE2:
+		return "SSE2";
+	default:
+		return "scalar";
+	}
+}
+
+static FN_DECIMAL InterpFunc(int interp, FN_DECIMAL t)
+{
+	switch (interp)
+	{
+	case FastNoise::Hermite:
+		return InterpHermiteFunc(t);
+	case FastNoise::Quintic:
+		return InterpQuinticFunc(t);
+	default:
+		return t;
+	}
+}
+
+#ifdef FN_GRID_SSE2
+// SSE2, 4 lanes
+
+static inline __m128 GridCoordSSE2(FN_DECIMAL start, FN_DECIMAL step, FN_DECIMAL frequency, int i)
+{
+	__m128 index = _mm_add_ps(_mm_set1_ps((FN_DECIMAL)i), _mm_setr_ps(0, 1, 2, 3));
+	return _mm_mul_ps(_mm_add_ps(_mm_set1_ps(start), _mm_mul_ps(index, _mm_set1_ps(step))), _mm_set1_ps(frequency));
+}
+
+// Same rounding as FastFloor: truncate, then step down for negative values
+static inline __m128i FastFloorSSE2(__m128 f)
+{
+	return _mm_add_epi32(_mm_cvttps_epi32(f), _mm_castps_si128(_mm_cmplt_ps(f, _mm_setzero_ps())));
+}
+
+static inline __m128 LerpSSE2(__m128 a, __m128 b, __m128 t)
+{
+	return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+static inline __m128 InterpSSE2(int interp, __m128 t)
+{
+	switch (interp)
+	{
+	case FastNoise::Hermite:
+		return _mm_mul_ps(_mm_mul_ps(t, t), _mm_sub_ps(_mm_set1_ps(3), _mm_mul_ps(_mm_set1_ps(2), t)));
+	case FastNoise::Quintic:
+		return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t),
+			_mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6)), _mm_set1_ps(15))), _mm_set1_ps(10)));
+	default:
+		return t;
+	}
+}
+
+static inline void StoreSSE2(FN_DECIMAL* out, __m128 v, int remaining)
+{
+	if (remaining >= 4)
+	{
+		_mm_storeu_ps(out, v);
+		return;
+	}
+
+	alignas(16) FN_DECIMAL tmp[4];
+	_mm_store_ps(tmp, v);
+	memcpy(out, tmp, remaining * sizeof(FN_DECIMAL));
+}
+
+static void ValueRowSSE2(const unsigned char* perm, int interp, FN_DECIMAL* out,
+	FN_DECIMAL x, FN_DECIMAL yStart, FN_DECIMAL step, FN_DECIMAL frequency, int count)
+{
+	x *= frequency;
+	int x0 = FastFloor(x);
+	int x0i = x0 & 0xff;
+	int x1i = (x0 + 1) & 0xff;
+	__m128 xs = _mm_set1_ps(InterpFunc(interp, x - (FN_DECIMAL)x0));
+
+	alignas(16) int y0[4];
+	alignas(16) FN_DECIMAL v00[4], v10[4], v01[4], v11[4];
+
+	for (int i = 0; i < count; i += 4)
+	{
+		__m128 y = GridCoordSSE2(yStart, step, frequency, i);
+		__m128i vy0 = FastFloorSSE2(y);
+		__m128 ys = InterpSSE2(interp, _mm_sub_ps(y, _mm_cvtepi32_ps(vy0)));
+
+		_mm_store_si128((__m128i*)y0, vy0);
+		for (int l = 0; l < 4; l++)
+		{
+			int p0 = perm[y0[l] & 0xff];
+			int p1 = perm[(y0[l] + 1) & 0xff];
+			v00[l] = VAL_LUT[perm[x0i + p0]];
+			v10[l] = VAL_LUT[perm[x1i + p0]];
+			v01[l] = VAL_LUT[perm[x0i + p1]];
+			v11[l] = VAL_LUT[perm[x1i + p1]];
+		}
+
+		__m128 xf0 = LerpSSE2(_mm_load_ps(v00), _mm_load_ps(v10), xs);
+		__m128 xf1 = LerpSSE2(_mm_load_ps(v01), _mm_load_ps(v11), xs);
+
+		StoreSSE2(out + i, LerpSSE2(xf0, xf1, ys), count - i);
+	}
+}
+
+static void PerlinRowSSE2(const unsigned char* perm, const unsigned char* perm12, int interp, FN_DECIMAL* out,
+	FN_DECIMAL x, FN_DECIMAL yStart, FN_DECIMAL step, FN_DECIMAL frequency, int count)
+{
+	x *= frequency;
+	int x0 = FastFloor(x);
+	int x0i = x0 & 0xff;
+	int x1i = (x0 + 1) & 0xff;
+	__m128 xs = _mm_set1_ps(InterpFunc(interp, x - (FN_DECIMAL)x0));
+	__m128 xd0 = _mm_set1_ps(x - (FN_DECIMAL)x0);
+	__m128 xd1 = _mm_set1_ps(x - (FN_DECIMAL)x0 - 1);
+
+	alignas(16) int y0[4];
+	alignas(16) FN_DECIMAL gx00[4], gy00[4], gx10[4], gy10[4], gx01[4], gy01[4], gx11[4], gy11[4];
+
+	for (int i = 0; i < count; i += 4)
+	{
+		__m128 y = GridCoordSSE2(yStart, step, frequency, i);
+		__m128i vy0 = FastFloorSSE2(y);
+		__m128 yd0 = _mm_sub_ps(y, _mm_cvtepi32_ps(vy0));
+		__m128 yd1 = _mm_sub_ps(yd0, _mm_set1_ps(1));
+		__m128 ys = InterpSSE2(interp, yd0);
+
+		_mm_store_si128((__m128i*)y0, vy0);
+		for (int l = 0; l < 4; l++)
+		{
+			int p0 = perm[y0[l] & 0xff];
+			int p1 = perm[(y0[l] + 1) & 0xff];
+			unsigned char lut00 = perm12[x0i + p0];
+			unsigned char lut10 = perm12[x1i + p0];
+			unsigned char lut01 = perm12[x0i + p1];
+			unsigned char lut11 = perm12[x1i + p1];
+			gx00[l] = GRAD_X[lut00]; gy00[l] = GRAD_Y[lut00];
+			gx10[l] = GRAD_X[lut10]; gy10[l] = GRAD_Y[lut10];
+			gx01[l] = GRAD_X[lut01]; gy01[l] = GRAD_Y[lut01];
+			gx11[l] = GRAD_X[lut11]; gy11[l] = GRAD_Y[lut11];
+		}
+
+		__m128 g00 = _mm_add_ps(_mm_mul_ps(xd0, _mm_load_ps(gx00)), _mm_mul_ps(yd0, _mm_load_ps(gy00)));
+		__m128 g10 = _mm_add_ps(_mm_mul_ps(xd1, _mm_load_ps(gx10)), _mm_mul_ps(yd0, _mm_load_ps(gy10)));
+		__m128 g01 = _mm_add_ps(_mm_mul_ps(xd0, _mm_load_ps(gx01)), _mm_mul_ps(yd1, _mm_load_ps(gy01)));
+		__m128 g11 = _mm_add_ps(_mm_mul_ps(xd1, _mm_load_ps(gx11)), _mm_mul_ps(yd1, _mm_load_ps(gy11)));
+
+		__m128 xf0 = LerpSSE2(g00, g10, xs);
+		__m128 xf1 = LerpSSE2(g01, g11, xs);
+
+		StoreSSE2(out + i, LerpSSE2(xf0, xf1, ys), count - i);
+	}
+}
+
+static inline __m128 SimplexCornerSSE2(__m128 xd, __m128 yd, const FN_DECIMAL* gx, const FN_DECIMAL* gy)
+{
+	__m128 t = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(0.5f), _mm_mul_ps(xd, xd)), _mm_mul_ps(yd, yd));
+	__m128 inside = _mm_cmpge_ps(t, _mm_setzero_ps());
+	t = _mm_mul_ps(t, t);
+	__m128 grad = _mm_add_ps(_mm_mul_ps(xd, _mm_load_ps(gx)), _mm_mul_ps(yd, _mm_load_ps(gy)));
+	return _mm_and_ps(inside, _mm_mul_ps(_mm_mul_ps(t, t), grad));
+}
+
+static void SimplexRowSSE2(const unsigned char* perm, const unsigned char* perm12, FN_DECIMAL* out,
+	FN_DECIMAL xRow, FN_DECIMAL yStart, FN_DECIMAL step, FN_DECIMAL frequency, int count)
+{
+	__m128 x = _mm_set1_ps(xRow * frequency);
+	__m128 one = _mm_set1_ps(1);
+	__m128 g2 = _mm_set1_ps(G2);
+	__m128 g2x2 = _mm_set1_ps(2 * G2);
+
+	alignas(16) int ci[4], cj[4], ci1[4], cj1[4];
+	alignas(16) FN_DECIMAL gx0[4], gy0[4], gx1[4], gy1[4], gx2[4], gy2[4];
+
+	for (int i = 0; i < count; i += 4)
+	{
+		__m128 y = GridCoordSSE2(yStart, step, frequency, i);
+
+		__m128 t = _mm_mul_ps(_mm_add_ps(x, y), _mm_set1_ps(F2));
+		__m128i vi = FastFloorSSE2(_mm_add_ps(x, t));
+		__m128i vj = FastFloorSSE2(_mm_add_ps(y, t));
+
+		t = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(vi, vj)), g2);
+		__m128 x0 = _mm_sub_ps(x, _mm_sub_ps(_mm_cvtepi32_ps(vi), t));
+		__m128 y0 = _mm_sub_ps(y, _mm_sub_ps(_mm_cvtepi32_ps(vj), t));
+
+		__m128 xGreater = _mm_cmpgt_ps(x0, y0);
+		__m128i vi1 = _mm_and_si128(_mm_castps_si128(xGreater), _mm_set1_epi32(1));
+		__m128i vj1 = _mm_sub_epi32(_mm_set1_epi32(1), vi1);
+
+		__m128 x1 = _mm_add_ps(_mm_sub_ps(x0, _mm_and_ps(xGreater, one)), g2);
+		__m128 y1 = _mm_add_ps(_mm_sub_ps(y0, _mm_andnot_ps(xGreater, one)), g2);
+		__m128 x2 = _mm_add_ps(_mm_sub_ps(x0, one), g2x2);
+		__m128 y2 = _mm_add_ps(_mm_sub_ps(y0, one), g2x2);
+
+		_mm_store_si128((__m128i*)ci, vi);
+		_mm_store_si128((__m128i*)cj, vj);
+		_mm_store_si128((__m128i*)ci1, vi1);
+		_mm_store_si128((__m128i*)cj1, vj1);
+		for (int l = 0; l < 4; l++)
+		{
+			unsigned char lut0 = perm12[(ci[l] & 0xff) + perm[cj[l] & 0xff]];
+			unsigned char lut1 = perm12[((ci[l] + ci1[l]) & 0xff) + perm[(cj[l] + cj1[l]) & 0xff]];
+			unsigned char lut2 = perm12[((ci[l] + 1) & 0xff) + perm[(cj[l] + 1) & 0xff]];
+			gx0[l] = GRAD_X[lut0]; gy0[l] = GRAD_Y[lut0];
+			gx1[l] = GRAD_X[lut1]; gy1[l] = GRAD_Y[lut1];
+			gx2[l] = GRAD_X[lut2]; gy2[l] = GRAD_Y[lut2];
+		}
+
+		__m128 n0 = SimplexCornerSSE2(x0, y0, gx0, gy0);
+		__m128 n1 = SimplexCornerSSE2(x1, y1, gx1, gy1);
+		__m128 n2 = SimplexCornerSSE2(x2, y2, gx2, gy2);
+
+		StoreSSE2(out + i, _mm_mul_ps(_mm_set1_ps(70), _mm_add_ps(_mm_add_ps(n0, n1), n2)), count - i);
+	}
+}
+#endif
+
+#ifdef FN_GRID_AVX2
+// AVX2, 8 lanes. Permutation tables are widened to ints so they can be gathered
+
+FN_AVX2_TARGET static inline __m256 GridCoordAVX2(FN_DECIMAL start, FN_DECIMAL step, FN_DECIMAL frequency, int i)
+{
+	__m256 index = _mm256_add_ps(_mm256_set1_ps((FN_DECIMAL)i), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+	return _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(start), _mm256_mul_ps(index, _mm256_set1_ps(step))), _mm256_set1_ps(frequency));
+}
+
+FN_AVX2_TARGET static inline __m256i FastFloorAVX2(__m256 f)
+{
+	return _mm256_add_epi32(_mm256_cvttps_epi32(f), _mm256_castps_si256(_mm256_cmp_ps(f, _mm256_setzero_ps(), _CMP_LT_OQ)));
+}
+
+FN_AVX2_TARGET static inline __m256 LerpAVX2(__m256 a, __m256 b, __m256 t)
+{
+	return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+FN_AVX2_TARGET static inline __m256 InterpAVX2(int interp, __m256 t)
+{
+	switch (interp)
+	{
+	case FastNoise::Hermite:
+		return _mm256_mul_ps(_mm256_mul_ps(t, t), _mm256_sub_ps(_mm256_set1_ps(3), _mm256_mul_ps(_mm256_set1_ps(2), t)));
+	case FastNoise::Quintic:
+		return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t),
+			_mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6)), _mm256_set1_ps(15))), _mm256_set1_ps(10)));
+	default:
+		return t;
+	}
+}
+
+FN_AVX2_TARGET static inline void StoreAVX2(FN_DECIMAL* out, __m256 v, int remaining)
+{
+	if (remaining >= 8)
+	{
+		_mm256_storeu_ps(out, v);
+		return;
+	}
+
+	alignas(32) FN_DECIMAL tmp[8];
+	_mm256_store_ps(tmp, v);
+	memcpy(out, tmp, remaining * sizeof(FN_DECIMAL));
+}
+
+FN_AVX2_TARGET static inline __m256i PermAVX2(const int* perm, __m256i index)
+{
+	return _mm256_i32gather_epi32(perm, index, 4);
+}
+
+FN_AVX2_TARGET static void ValueRowAVX2(const int* perm, int interp, FN_DECIMAL* out,
+	FN_DECIMAL x, FN_DECIMAL yStart, FN_DECIMAL step, FN_DECIMAL frequency, int count)
+{
+	x *= frequency;
+	int x0 = FastFloor(x);
+	__m256i x0i = _mm256_set1_epi32(x0 & 0xff);
+	__m256i x1i = _mm256_set1_epi32((x0 + 1) & 0xff);
+	__m256 xs = _mm256_set1_ps(InterpFunc(interp, x - (FN_DECIMAL)x0));
+	__m256i mask = _mm256_set1_epi32(0xff);
+
+	for (int i = 0; i < count; i += 8)
+	{
+		__m256 y = GridCoordAVX2(yStart, step, frequency, i);
+		__m256i y0 = FastFloorAVX2(y);
+		__m256 ys = InterpAVX2(interp, _mm256_sub_ps(y, _mm256_cvtepi32_ps(y0)));
+
+		__m256i p0 = PermAVX2(perm, _mm256_and_si256(y0, mask));
+		__m256i p1 = PermAVX2(perm, _mm256_and_si256(_mm256_add_epi32(y0, _mm256_set1_epi32(1)), mask));
+
+		__m256 v00 = _mm256_i32gather_ps(VAL_LUT, PermAVX2(perm, _mm256_add_epi32(x0i, p0)), 4);
+		__m256 v10 = _mm256_i32gather_ps(VAL_LUT, PermAVX2(perm, _mm256_add_epi32(x1i, p0)), 4);
+		__m256 v01 = _mm256_i32gather_ps(VAL_LUT, PermAVX2(perm, _mm256_add_epi32(x0i, p1)), 4);
+		__m256 v11 = _mm256_i32gather_ps(VAL_LUT, PermAVX2(perm, _mm256_add_epi32(x1i, p1)), 4);
+
+		__m256 xf0 = LerpAVX2(v00, v10, xs);
+		__m256 xf1 = LerpAVX2(v01, v11, xs);
+
+		StoreAVX2(out + i, LerpAVX2(xf0, xf1, ys), count - i);
+	}
+}
+
+FN_AVX2_TARGET static inline __m256 GradAVX2(const int* perm12, __m256i index, __m256 xd, __m256 yd)
+{
+	__m256i lut = PermAVX2(perm12, index);
+	return _mm256_add_ps(_mm256_mul_ps(xd, _mm256_i32gather_ps(GRAD_X, lut, 4)),
+		_mm256_mul_ps(yd, _mm256_i32gather_ps(GRAD_Y, lut, 4)));
+}
+
+FN_AVX2_TARGET static void PerlinRowAVX2(const int* perm, const int* perm12, int interp, FN_DECIMAL* out,
+	FN_DECIMAL x, FN_DECIMAL yStart, FN_DECIMAL step, FN_DECIMAL frequency, int count)
+{
+	x *= frequency;
+	int x0 = FastFloor(x);
+	__m256i x0i = _mm256_set1_epi32(x0 & 0xff);
+	__m256i x1i = _mm256_set1_epi32((x0 + 1) & 0xff);
+	__m256 xs = _mm256_set1_ps(InterpFunc(interp, x - (FN_DECIMAL)x0));
+	__m256 xd0 = _mm256_set1_ps(x - (FN_DECIMAL)x0);
+	__m256 xd1 = _mm256_set1_ps(x - (FN_DECIMAL)x0 - 1);
+	__m256i mask = _mm256_set1_epi32(0xff);
+
+	for (int i = 0; i < count; i += 8)
+	{
+		__m256 y = GridCoordAVX2(yStart, step, frequency, i);
+		__m256i y0 = FastFloorAVX2(y);
+		__m256 yd0 = _mm256_sub_ps(y, _mm256_cvtepi32_ps(y0));
+		__m256 yd1 = _mm256_sub_ps(yd0, _mm256_set1_ps(1));
+		__m256 ys = InterpAVX2(interp, yd0);
+
+		__m256i p0 = PermAVX2(perm, _mm256_and_si256(y0, mask));
+		__m256i p1 = PermAVX2(perm, _mm256_and_si256(_mm256_add_epi32(y0, _mm256_set1_epi32(1)), mask));
+
+		__m256 g00 = GradAVX2(perm12, _mm256_add_epi32(x0i, p0), xd0, yd0);
+		__m256 g10 = GradAVX2(perm12, _mm256_add_epi32(x1i, p0), xd1, yd0);
+		__m256 g01 = GradAVX2(perm12, _mm256_add_epi32(x0i, p1), xd0, yd1);
+		__m256 g11 = GradAVX2(perm12, _mm256_add_epi32(x1i, p1), xd1, yd1);
+
+		__m256 xf0 = LerpAVX2(g00, g10, xs);
+		__m256 xf1 = LerpAVX2(g01, g11, xs);
+
+		StoreAVX2(out + i, LerpAVX2(xf0, xf1, ys), count - i);
+	}
+}
+
+FN_AVX2_TARGET static inline __m256 SimplexCornerAVX2(const int* perm, const int* perm12, __m256i ci, __m256i cj, __m256 xd, __m256 yd)
+{
+	__m256i mask = _mm256_set1_epi32(0xff);
+	__m256i index = _mm256_add_epi32(_mm256_and_si256(ci, mask), PermAVX2(perm, _mm256_and_si256(cj, mask)));
+
+	__m256 t = _mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(0.5f), _mm256_mul_ps(xd, xd)), _mm256_mul_ps(yd, yd));
+	__m256 inside = _mm256_cmp_ps(t, _mm256_setzero_ps(), _CMP_GE_OQ);
+	t = _mm256_mul_ps(t, t);
+	return _mm256_and_ps(inside, _mm256_mul_ps(_mm256_mul_ps(t, t), GradAVX2(perm12, index, xd, yd)));
+}
+
+FN_AVX2_TARGET static void SimplexRowAVX2(const int* perm, const int* perm12, FN_DECIMAL* out,
+	FN_DECIMAL xRow, FN_DECIMAL yStart, FN_DECIMAL step, FN_DECIMAL frequency, int count)
+{
+	__m256 x = _mm256_set1_ps(xRow * frequency);
+	__m256 one = _mm256_set1_ps(1);
+	__m256i oneInt = _mm256_set1_epi32(1);
+	__m256 g2 = _mm256_set1_ps(G2);
+	__m256 g2x2 = _mm256_set1_ps(2 * G2);
+
+	for (int i = 0; i < count; i += 8)
+	{
+		__m256 y = GridCoordAVX2(yStart, step, frequency, i);
+
+		__m256 t = _mm256_mul_ps(_mm256_add_ps(x, y), _mm256_set1_ps(F2));
+		__m256i vi = FastFloorAVX2(_mm256_add_ps(x, t));
+		__m256i vj = FastFloorAVX2(_mm256_add_ps(y, t));
+
+		t = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(vi, vj)), g2);
+		__m256 x0 = _mm256_sub_ps(x, _mm256_sub_ps(_mm256_cvtepi32_ps(vi), t));
+		__m256 y0 = _mm256_sub_ps(y, _mm256_sub_ps(_mm256_cvtepi32_ps(vj), t));
+
+		__m256 xGreater = _mm256_cmp_ps(x0, y0, _CMP_GT_OQ);
+		__m256i vi1 = _mm256_and_si256(_mm256_castps_si256(xGreater), oneInt);
+		__m256i vj1 = _mm256_sub_epi32(oneInt, vi1);
+
+		__m256 x1 = _mm256_add_ps(_mm256_sub_ps(x0, _mm256_and_ps(xGreater, one)), g2);
+		__m256 y1 = _mm256_add_ps(_mm256_sub_ps(y0, _mm256_andnot_ps(xGreater, one)), g2);
+		__m256 x2 = _mm256_add_ps(_mm256_sub_ps(x0, one), g2x2);
+		__m256 y2 = _mm256_add_ps(_mm256_sub_ps(y0, one), g2x2);
+
+		__m256 n0 = SimplexCornerAVX2(perm, perm12, vi, vj, x0, y0);
+		__m256 n1 = SimplexCornerAVX2(perm, perm12, _mm256_add_epi32(vi, vi1), _mm256_add_epi32(vj, vj1), x1, y1);
+		__m256 n2 = SimplexCornerAVX2(perm, perm12, _mm256_add_epi32(vi, oneInt), _mm256_add_epi32(vj, oneInt), x2, y2);
+
+		StoreAVX2(out + i, _mm256_mul_ps(_mm256_set1_ps(70), _mm256_add_ps(_mm256_add_ps(n0, n1), n2)), count - i);
+	}
+}
+
+static void WidenPerm(const unsigned char* perm, int* wide)
+{
+	for (int i = 0; i < 512; i++)
+		wide[i] = perm[i];
+}
+#endif
+
+void FastNoise::GetValueGrid(FN_DECIMAL* out, FN_DECIMAL xStart, FN_DECIMAL yStart, FN_DECIMAL step, int xCount, int yCount) const
+{
+	GridLevel level = GetGridLevel();
+
+#ifdef FN_GRID_AVX2
+	int perm[512];
+	if (level == GRID_AVX2)
+		WidenPerm(m_perm, perm);
+#endif
+
+	for (int xi = 0; xi < xCount; xi++)
+	{
+		FN_DECIMAL x = xStart + (FN_DECIMAL)xi * step;
+		FN_DECIMAL* row = out + xi * yCount;
+
+		switch (level)
+		{
+#ifdef FN_GRID_AVX2
+		case GRID_AVX2:
+			ValueRowAVX2(perm, m_interp, row, x, yStart, step, m_frequency, yCount);
+			break;
+#endif
+#ifdef FN_GRID_SSE2
+		case GRID_SSE2:
+			ValueRowSSE2(m_perm, m_interp, row, x, yStart, step, m_frequency, yCount);
+			break;
+#endif
+		default:
+			for (int yi = 0; yi < yCount; yi++)
+				row[yi] = GetValue(x, yStart + (FN_DECIMAL)yi * step);
+			break;
+		}
+	}
+}
+
+void FastNoise::GetPerlinGrid(FN_DECIMAL* out, FN_DECIMAL xStart, FN_DECIMAL yStart, FN_DECIMAL step, int xCount, int yCount) const
+{
+	GridLevel level = GetGridLevel();
+
+#ifdef FN_GRID_AVX2
+	int perm[512];
+	int perm12[512];
+	if (level == GRID_AVX2)
+	{
+		WidenPerm(m_perm, perm);
+		WidenPerm(m_perm12, perm12);
+	}
+#endif
+
+	for (int xi = 0; xi < xCount; xi++)
+	{
+		FN_DECIMAL x = xStart + (FN_DECIMAL)xi * step;
+		FN_DECIMAL* row = out + xi * yCount;
+
+		switch (level)
+		{
+#ifdef FN_GRID_AVX2
+		case GRID_AVX2:
+			PerlinRowAVX2(perm, perm12, m_interp, row, x, yStart, step, m_frequency, yCount);
+			break;
+#endif
+#ifdef FN_GRID_SSE2
+		case GRID_SSE2:
+			PerlinRowSSE2(m_perm, m_perm12, m_interp, row, x, yStart, step, m_frequency, yCount);
+			break;
+#endif
+		default:
+			for (int yi = 0; yi < yCount; yi++)
+				row[yi] = GetPerlin(x, yStart + (FN_DECIMAL)yi * step);
+			break;
+		}
+	}
+}
+
+void FastNoise::GetSimplexGrid(FN_DECIMAL* out, FN_DECIMAL xStart, FN_DECIMAL yStart, FN_DECIMAL step, int xCount, int yCount) const
+{
+	GridLevel level = GetGridLevel();
+
+#ifdef FN_GRID_AVX2
+	int perm[512];
+	int perm12[512];
+	if (level == GRID_AVX2)
+	{
+		WidenPerm(m_perm, perm);
+		WidenPerm(m_perm12, perm12);
+	}
+#endif
+
+	for (int xi = 0; xi < xCount; xi++)
+	{
+		FN_DECIMAL x = xStart + (FN_DECIMAL)xi * step;
+		FN_DECIMAL* row = out + xi * yCount;
+
+		switch (level)
+		{
+#ifdef FN_GRID_AVX2
+		case GRID_AVX2:
+			SimplexRowAVX2(perm, perm12, row, x, yStart, step, m_frequency, yCount);
+			break;
+#endif
+#ifdef FN_GRID_SSE2
+		case GRID_SSE2:
+			SimplexRowSSE2(m_perm, m_perm12, row, x, yStart, step, m_frequency, yCount);
+			break;
+#endif
+		default:
+			for (int yi = 0; yi < yCount; yi++)
+				row[yi] = GetSimplex(x, yStart + (FN_DECIMAL)yi * step);
+			break;
+		}
+	}
+}
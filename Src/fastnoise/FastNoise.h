@@ -184,6 +184,21 @@ public:
 	void GradientPerturb(FN_DECIMAL& x, FN_DECIMAL& y) const;
 	void GradientPerturbFractal(FN_DECIMAL& x, FN_DECIMAL& y) const;
 
+	// Batched 2D evaluation over a regular grid, vectorised where the CPU allows
+	// out[xi * yCount + yi] = Get...(xStart + xi * step, yStart + yi * step)
+	// Results match the single point functions
+	void GetValueGrid(FN_DECIMAL* out, FN_DECIMAL xStart, FN_DECIMAL yStart, FN_DECIMAL step, int xCount, int yCount) const;
+	void GetPerlinGrid(FN_DECIMAL* out, FN_DECIMAL xStart, FN_DECIMAL yStart, FN_DECIMAL step, int xCount, int yCount) const;
+	void GetSimplexGrid(FN_DECIMAL* out, FN_DECIMAL xStart, FN_DECIMAL yStart, FN_DECIMAL step, int xCount, int yCount) const;
+
+	// Returns the instruction set the grid functions use on this CPU: "AVX2", "SSE2" or "scalar"
+	static const char* GetGridInstructionSet();
+
+	// Forces the grid functions onto "AVX2", "SSE2" or "scalar", nullptr goes back to detection.
+	// Returns false when this build or CPU can't run the one asked for. Meant for tests, but safe to call
+	// while other threads generate: a grid call already running finishes on the set it started with
+	static bool SetGridInstructionSet(const char* name);
+
 	//3D
 	FN_DECIMAL GetValue(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const;
 	FN_DECIMAL GetValueFractal(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const;
@@ -4,7 +4,8 @@
 #include "camera.h"
 #include "Physics.h"
 #include "Graphics/renderer.h"
-#include "terrainChunkGenerator.h"
+#include "chunkManager.h"
+#include "worldConfig.h"
 #include "terrainChunk.h"
 
 #include "glad/glad.h"
@@ -27,30 +28,40 @@ public:
 
         initWindow();
 
+        PROFILE_THREAD_NAME("main");
+
         cam = new Camera();
         
-        chunks = generateChunks(8);
-        
-        physics = new PhysicsSim();
-        physics->createTerrainCollisionShapes(chunks);
+        physics = new PhysicsSim(COLLISION_RADIUS, worldConfig, COLLISION_CACHE_PATH);
+
+        chunkManager = new ChunkManager(CHUNK_VIEW_RADIUS, CHUNK_CPU_BUDGET, CHUNK_GPU_BUDGET, worldConfig, CHUNK_CACHE_PATH);
+        //collision is built on demand near the player, only unloading has to be passed on
+        chunkManager->setChunkCallbacks(
+            nullptr,
+            [this](TerrainChunk* chunk) { physics->removeTerrainChunk(chunk->getData()); });
+
+        //only the ground under the spawn point is generated up front,
+        //the rest streams in while playing
+        chunkManager->loadSpawn(glm::vec3(0.f));
         
         renderer = new Renderer(window);
-        renderer->setTerrain(chunks);
+        renderer->setTerrain(&chunkManager->getQuadtree());
 
         player = new Player();
 
         physics->createPlayerRigidBody(player);
+
+        //the ground under the player is in the world before the first tick
+        physics->updateTerrainCollision(chunkManager->getQuadtree());
+        physics->collectTerrainBodies(true);
+        physics->start();
     }
 
     ~Game()
     {
         delete renderer;
         
-        for(TerrainChunk* chunk : chunks)
-        {
-            delete chunk;
-        }
-        chunks.clear();
+        delete chunkManager;
 
         delete physics;
         delete cam;
@@ -75,6 +86,9 @@ public:
             float currTime = SDL_GetTicks() / 1000.f;
             float dt = currTime - prevTime;
             prevTime = currTime;
+
+            PROFILE_BEGIN_FRAME();
+            PROFILE_SCOPE("frame");
             
             while (SDL_PollEvent(&event)) 
             {
@@ -107,6 +121,29 @@ public:
                         case SDLK_s:
                             down = true;
                             break;
+                        case SDLK_h:
+                            physics->setTerrainCollisionBackend(
+                                physics->getTerrainCollisionBackend() == TERRAIN_COLLISION_BVH ?
+                                TERRAIN_COLLISION_HEIGHTFIELD : TERRAIN_COLLISION_BVH);
+                            std::cout << "terrain collision: " 
+                                      << getTerrainCollisionBackendName(physics->getTerrainCollisionBackend())
+                                      << ", " << physics->getNumTerrainBodies() << " chunks" << std::endl;
+                            break;
+#ifndef PROFILER_DISABLED
+                        case SDLK_o:
+                            renderer->setProfilerOverlayVisible(!renderer->isProfilerOverlayVisible());
+                            break;
+                        case SDLK_p:
+                            if(Profiler::get().writeChromeTrace(PROFILE_TRACE_PATH))
+                            {
+                                std::cout << "profile written to " << PROFILE_TRACE_PATH << std::endl;
+                            }
+                            else
+                            {
+                                std::cout << "couldn't write " << PROFILE_TRACE_PATH << std::endl;
+                            }
+                            break;
+#endif
                         default:
                             break;
                     }		
@@ -135,19 +172,20 @@ public:
 
             
             float forceScale = 4096.f;
+            glm::vec3 force(0.f);
             if(up)
             {
                 glm::vec3 forceDir = player->getPosition() - cam->getPosition();
                 forceDir.y = 0;
                 forceDir = glm::normalize(forceDir);
-                player->applyForce(forceDir*forceScale);
+                force += forceDir*forceScale;
             }
             if(down)
             {
                 glm::vec3 forceDir = player->getPosition() - cam->getPosition();
                 forceDir.y = 0;
                 forceDir = -glm::normalize(forceDir);
-                player->applyForce(forceDir*forceScale);
+                force += forceDir*forceScale;
             }
             if(left)
             {
@@ -156,7 +194,7 @@ public:
                 forceDir.y = 0;
                 forceDir = glm::normalize(forceDir);
                 forceDir = rotation * glm::vec4(forceDir, 1.f);
-                player->applyForce(forceDir*forceScale);
+                force += forceDir*forceScale;
             }
             if(right)
             {
@@ -165,11 +203,18 @@ public:
                 forceDir.y = 0;
                 forceDir = glm::normalize(forceDir);
                 forceDir = rotation * glm::vec4(forceDir, 1.f);
-                player->applyForce(forceDir*forceScale);
+                force += forceDir*forceScale;
             }
 
-            physics->step();
+            player->setForce(force);
+
             cam->followTarget(player->getPosition());
+
+            {
+                PROFILE_SCOPE("chunks");
+                chunkManager->update(player->getPosition());
+            }
+            physics->updateTerrainCollision(chunkManager->getQuadtree());
             
 
             int w,h;
@@ -185,7 +230,10 @@ public:
             
 
 
-            SDL_GL_SwapWindow(window);
+            {
+                PROFILE_SCOPE("swap");
+                SDL_GL_SwapWindow(window);
+            }
         }
     }
 
@@ -194,7 +242,23 @@ private:
 
     bool running;
 
-    std::vector<TerrainChunk*> chunks;
+    ChunkManager* chunkManager;
+
+    static const int CHUNK_VIEW_RADIUS = 8;
+
+    //about a chunk around the player, everything further out has no collision
+    static constexpr float COLLISION_RADIUS = 128.f;
+    static const size_t CHUNK_CPU_BUDGET = 512 * 1024 * 1024;
+    static const size_t CHUNK_GPU_BUDGET = 512 * 1024 * 1024;
+
+    //fixed seed so terrain explored in earlier runs comes back out of the chunk cache
+    WorldConfig worldConfig;
+    static constexpr const char* CHUNK_CACHE_PATH = "terrain.cache";
+    //BVHs of the same terrain, so revisited chunks get collision without building it
+    static constexpr const char* COLLISION_CACHE_PATH = "terrain.collision.cache";
+
+    //written with p, open in chrome://tracing or Perfetto
+    static constexpr const char* PROFILE_TRACE_PATH = "profile.json";
 
     Camera* cam;
 
@@ -0,0 +1,182 @@
+#include "grassField.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "chunkData.h"
+
+// splitmix64, small and the same on every platform unlike the <random> distributions
+class GrassRandom
+{
+private:
+    uint64_t state;
+
+public:
+    explicit GrassRandom(uint64_t seed) : state(seed)
+    {
+    }
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    //[0, 1) with 24 bits, exact in a float
+    float nextFloat()
+    {
+        return (next() >> 40) * (1.f / 16777216.f);
+    }
+};
+
+static float smoothstep(float edge0, float edge1, float x)
+{
+    if(edge1 <= edge0) return x >= edge1 ? 1.f : 0.f;
+
+    float t = std::fmin(std::fmax((x - edge0) / (edge1 - edge0), 0.f), 1.f);
+    return t * t * (3.f - 2.f * t);
+}
+
+float GrassField::getDensity(const GrassConfig& config, float normalizedHeight, float slope)
+{
+    float heightFactor = smoothstep(config.minHeight - config.heightFade, config.minHeight, normalizedHeight) *
+                         (1.f - smoothstep(config.maxHeight, config.maxHeight + config.heightFade, normalizedHeight));
+
+    float slopeFactor = 1.f - smoothstep(config.flatSlope, config.maxSlope, slope);
+
+    return heightFactor * slopeFactor;
+}
+
+GrassField::GrassField(ChunkData* chunk, const GrassConfig& config)
+{
+    maxBladeHeight = config.maxBladeHeight;
+    scatter(chunk, config);
+}
+
+void GrassField::scatter(ChunkData* chunk, const GrassConfig& config)
+{
+    //neighbouring chunks share their edge line, so cells 0..terrainSize tile the world without overlap
+    int cells = chunk->getTerrainSize() + 1;
+    int gridSize = chunk->getTerrainSize() + 2;
+    float heightScale = chunk->getHeightScale();
+    TerrainVertex* vertices = chunk->getVertexBuffer();
+
+    int wholeCandidates = (int)config.bladesPerCell;
+    float extraCandidate = config.bladesPerCell - wholeCandidates;
+
+    GrassRandom random(chunk->getIdentity());
+
+    //every candidate kept is the most there can be, the sort copies out only the kept ones
+    size_t maxBlades = (size_t)cells * cells * (size_t)std::ceil(config.bladesPerCell);
+    std::vector<GrassBlade> scattered;
+    std::vector<uint16_t> priorities;
+    scattered.reserve(maxBlades);
+    priorities.reserve(maxBlades);
+
+    for(int x = 0; x < cells; ++x)
+    {
+        for(int z = 0; z < cells; ++z)
+        {
+            float h00 = chunk->decodeHeight(vertices[x * gridSize + z].height);
+            float h01 = chunk->decodeHeight(vertices[x * gridSize + z + 1].height);
+            float h10 = chunk->decodeHeight(vertices[(x + 1) * gridSize + z].height);
+            float h11 = chunk->decodeHeight(vertices[(x + 1) * gridSize + z + 1].height);
+
+            int candidates = wholeCandidates + (random.nextFloat() < extraCandidate ? 1 : 0);
+            for(int i = 0; i < candidates; ++i)
+            {
+                //every candidate draws the same numbers whether it is kept or not,
+                //so a config change only affects the blades it has to
+                float tx = random.nextFloat();
+                float tz = random.nextFloat();
+                float keep = random.nextFloat();
+                uint64_t variation = random.next();
+
+                //same triangle split as the rendered mesh, (x0, z0) to (x1, z1)
+                float ground;
+                float slopeX;
+                float slopeZ;
+                if(tz >= tx)
+                {
+                    ground = h00 + tz * (h01 - h00) + tx * (h11 - h01);
+                    slopeX = h11 - h01;
+                    slopeZ = h01 - h00;
+                }
+                else
+                {
+                    ground = h00 + tx * (h10 - h00) + tz * (h11 - h10);
+                    slopeX = h10 - h00;
+                    slopeZ = h11 - h10;
+                }
+
+                float slope = std::sqrt(slopeX * slopeX + slopeZ * slopeZ);
+                if(keep >= getDensity(config, ground / heightScale, slope)) continue;
+
+                float heightT = (variation >> 32 & 0xFFFF) / 65535.f;
+                float bladeHeight = config.minBladeHeight + heightT * (config.maxBladeHeight - config.minBladeHeight);
+
+                GrassBlade blade;
+                blade.x = (uint16_t)((x + tx) * 256.f);
+                blade.z = (uint16_t)((z + tz) * 256.f);
+                blade.y = (uint16_t)(std::fmin(std::fmax(ground / heightScale, 0.f), 1.f) * 65535.f + 0.5f);
+                blade.height = (uint16_t)(bladeHeight / config.maxBladeHeight * 65535.f + 0.5f);
+                blade.rotation = variation & 0xFF;
+                blade.windPhase = variation >> 8 & 0xFF;
+                blade.width = variation >> 16 & 0xFF;
+                blade.tint = variation >> 24 & 0xFF;
+
+                scattered.push_back(blade);
+                priorities.push_back(variation >> 48);
+            }
+        }
+    }
+
+    sortByPriority(scattered, priorities);
+}
+
+void GrassField::sortByPriority(const std::vector<GrassBlade>& scattered, const std::vector<uint16_t>& priorities)
+{
+    //LSD radix sort on the 16 bit priority, a byte per pass. Stable, so equal
+    //priorities keep their scatter order
+    size_t count = scattered.size();
+
+    std::vector<uint32_t> order(count);
+    std::vector<uint32_t> sortedOrder(count);
+    for(size_t i = 0; i < count; ++i)
+    {
+        order[i] = i;
+    }
+
+    for(int shift = 0; shift < 16; shift += 8)
+    {
+        uint32_t starts[256] = {};
+        for(size_t i = 0; i < count; ++i)
+        {
+            starts[priorities[i] >> shift & 0xFF]++;
+        }
+
+        uint32_t offset = 0;
+        for(int b = 0; b < 256; ++b)
+        {
+            uint32_t size = starts[b];
+            starts[b] = offset;
+            offset += size;
+        }
+
+        for(size_t i = 0; i < count; ++i)
+        {
+            uint32_t index = order[i];
+            sortedOrder[starts[priorities[index] >> shift & 0xFF]++] = index;
+        }
+
+        order.swap(sortedOrder);
+    }
+
+    blades.resize(count);
+    for(size_t i = 0; i < count; ++i)
+    {
+        blades[i] = scattered[order[i]];
+    }
+}
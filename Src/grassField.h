@@ -0,0 +1,94 @@
+#ifndef GRASS_FIELD_H
+#define GRASS_FIELD_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "worldConfig.h"
+
+class ChunkData;
+
+// One grass blade, uploaded as is as a per-instance attribute. The blade's
+// shape is built in grass.vert from gl_VertexID, only this varies per blade
+struct GrassBlade
+{
+    //position in chunk grid units, 8.8 fixed point
+    uint16_t x;
+    uint16_t z;
+
+    //ground height, quantized like TerrainVertex::height
+    uint16_t y;
+
+    //blade height / GrassConfig::maxBladeHeight quantized to [0, 65535]
+    uint16_t height;
+
+    //yaw and wind cycle offset, 256 steps per turn
+    uint8_t rotation;
+    uint8_t windPhase;
+
+    //random per blade, the shader uses them to vary width and color
+    uint8_t width;
+    uint8_t tint;
+};
+
+static_assert(sizeof(GrassBlade) == 12, "GrassBlade is uploaded as is, keep it tightly packed");
+
+// Grass blades scattered over a chunk. Candidates are jittered over every grid
+// cell and kept with the probability of getDensity at that point, the random
+// numbers are seeded from the chunk's identity so the same chunk always grows
+// the same grass. CPU only, it runs on the generation workers.
+//
+// The blades are ordered by a random priority drawn with the rest of the blade,
+// so any prefix of getBlades is an even thinning of the whole field. Lower
+// density LODs draw a prefix of the same buffer, and a blade keeps its place
+// whatever else is drawn
+class GrassField
+{
+private:
+
+    std::vector<GrassBlade> blades;
+
+    float maxBladeHeight;
+
+    void scatter(ChunkData* chunk, const GrassConfig& config);
+    void sortByPriority(const std::vector<GrassBlade>& scattered, const std::vector<uint16_t>& priorities);
+
+public:
+
+    GrassField(ChunkData* chunk, const GrassConfig& config);
+
+    // [0, 1] chance of keeping a blade at normalizedHeight (height / heightScale) on ground this steep
+    static float getDensity(const GrassConfig& config, float normalizedHeight, float slope);
+
+    const GrassBlade* getBlades()
+    {
+        return blades.data();
+    }
+
+    size_t getNumBlades()
+    {
+        return blades.size();
+    }
+
+    // scale of GrassBlade::height
+    float getMaxBladeHeight()
+    {
+        return maxBladeHeight;
+    }
+
+    size_t getMemoryUsage()
+    {
+        return blades.size() * sizeof(GrassBlade);
+    }
+
+    // upper bound of getMemoryUsage for any chunk of this size, for the streaming budget
+    static size_t getMaxMemoryUsage(int terrainSize, const GrassConfig& config)
+    {
+        size_t cells = (terrainSize + 1) * (terrainSize + 1);
+        return cells * (size_t)std::ceil(config.bladesPerCell) * sizeof(GrassBlade);
+    }
+};
+
+#endif
@@ -1,10 +1,13 @@
 #ifndef GAME_PLAYER_H
 #define GAME_PLAYER_H
 
+#include <mutex>
+
 #include <bullet/btBulletDynamicsCommon.h>
 #include <glm/glm.hpp>
 
 #include "model.h"
+#include "transformSnapshot.h"
 #include "utils.h"
 
 class Player
@@ -16,6 +19,12 @@ private:
     float radius;
     Model* model;
 
+    //set by the game, applied by the physics thread on every tick
+    std::mutex forceMutex;
+    glm::vec3 force = glm::vec3(0.f);
+
+    TransformSnapshot snapshot;
+
 public: 
     Player()
     {
@@ -27,40 +36,59 @@ public:
         delete model;
     }
 
-    void applyForce(glm::vec3 force)
+    // held until it is set again, so the push doesn't depend on how many frames fall in a tick
+    void setForce(glm::vec3 force)
+    {
+        std::lock_guard<std::mutex> lock(forceMutex);
+        this->force = force;
+    }
+
+    // physics thread, before a tick
+    void applyForce()
     {
+        glm::vec3 force;
+        {
+            std::lock_guard<std::mutex> lock(forceMutex);
+            force = this->force;
+        }
+
+        if(force == glm::vec3(0.f)) return;
+
         body->activate();
         body->applyCentralForce(btVector3(force.x, force.y, force.z));
     }
 
+    // physics thread, after a tick simulated up to time
+    void publishTransform(double time)
+    {
+        btTransform trans;
+        body->getMotionState()->getWorldTransform(trans);
+        snapshot.publish(trans, time);
+    }
+
     Model* getModel()
     {
         return model;   
     }
 
+    // interpolated between the last two ticks, safe while the physics thread runs
     glm::mat4 getTransform()
     {
-        btTransform trans;
-        body->getMotionState()->getWorldTransform(trans);
-        glm::mat4 transform =  bulletToGlm(trans);
-
-        return transform;
+        return snapshot.getTransform(TransformSnapshot::now());
     }
 
     glm::vec3 getPosition()
     {
-        btTransform trans;
-        body->getMotionState()->getWorldTransform(trans);
-
-        return glm::vec3(trans.getOrigin().getX(),
-                         trans.getOrigin().getY(),
-                         trans.getOrigin().getZ());
+        return snapshot.getPosition(TransformSnapshot::now());
     }
 
     void setRigidBody(btRigidBody* rb)
     {
         body = rb;
 
+        btTransform trans;
+        body->getMotionState()->getWorldTransform(trans);
+        snapshot.reset(trans, TransformSnapshot::now());
     }
 };
 
@@ -0,0 +1,244 @@
+#include "profiler.h"
+
+#include <chrono>
+#include <cstdio>
+
+typedef std::chrono::steady_clock ProfileClock;
+
+static const ProfileClock::time_point profileEpoch = ProfileClock::now();
+
+//the string as a JSON string literal, names can hold anything setThreadName was given
+static void writeJsonString(FILE* file, const char* string)
+{
+    fputc('"', file);
+    for(const unsigned char* c = (const unsigned char*)string; *c; ++c)
+    {
+        switch(*c)
+        {
+            case '"':
+                fputs("\\\"", file);
+                break;
+            case '\\':
+                fputs("\\\\", file);
+                break;
+            case '\n':
+                fputs("\\n", file);
+                break;
+            case '\t':
+                fputs("\\t", file);
+                break;
+            default:
+                if(*c < 0x20) fprintf(file, "\\u%04x", *c);
+                else fputc(*c, file);
+                break;
+        }
+    }
+    fputc('"', file);
+}
+
+Profiler::Profiler()
+{
+    slots = new Slot[CAPACITY];
+    for(size_t i = 0; i < CAPACITY; ++i)
+    {
+        slots[i].sequence.store(0, std::memory_order_relaxed);
+    }
+
+    writeIndex = 0;
+    enabled = true;
+    nextThread = 0;
+}
+
+Profiler::~Profiler()
+{
+    //queries die with the context, which is gone by the time statics are destroyed
+    delete[] slots;
+}
+
+Profiler& Profiler::get()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+uint64_t Profiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(ProfileClock::now() - profileEpoch).count();
+}
+
+uint32_t Profiler::getThreadId()
+{
+    static thread_local uint32_t id = get().nextThread++;
+    return id;
+}
+
+void Profiler::setThreadName(const std::string& name)
+{
+    uint32_t id = getThreadId();
+
+    std::lock_guard<std::mutex> lock(threadNameMutex);
+    if(threadNames.size() <= id) threadNames.resize(id + 1);
+    threadNames[id] = name;
+}
+
+void Profiler::record(const char* name, uint64_t start, uint64_t end, uint32_t thread)
+{
+    uint64_t index = writeIndex.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots[index & (CAPACITY - 1)];
+
+    //0 marks the slot as being written, readers skip it until the final sequence is in
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    slot.thread.store(thread, std::memory_order_relaxed);
+
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+uint64_t Profiler::readRecords(uint64_t from, std::vector<ProfileRecord>& records)
+{
+    uint64_t to = getWriteIndex();
+    if(to - from > CAPACITY) from = to - CAPACITY;
+
+    for(uint64_t index = from; index < to; ++index)
+    {
+        const Slot& slot = slots[index & (CAPACITY - 1)];
+
+        //still being written, or already overwritten by a later zone
+        if(slot.sequence.load(std::memory_order_acquire) != index + 1) continue;
+
+        ProfileRecord record;
+        record.name = slot.name.load(std::memory_order_relaxed);
+        record.start = slot.start.load(std::memory_order_relaxed);
+        record.end = slot.end.load(std::memory_order_relaxed);
+        record.thread = slot.thread.load(std::memory_order_relaxed);
+        record.gpu = record.thread == GPU_THREAD;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(slot.sequence.load(std::memory_order_relaxed) != index + 1) continue;
+
+        records.push_back(record);
+    }
+
+    return to;
+}
+
+void Profiler::beginFrame()
+{
+    if(!gpuChecked)
+    {
+        //timestamp queries are core since 3.3
+        gpuTimers = GLAD_GL_VERSION_3_3;
+        gpuChecked = true;
+    }
+
+    if(gpuTimers) collectGpuZones();
+}
+
+GLuint Profiler::getQuery()
+{
+    if(freeQueries.empty())
+    {
+        GLuint query;
+        glGenQueries(1, &query);
+        return query;
+    }
+
+    GLuint query = freeQueries.back();
+    freeQueries.pop_back();
+    return query;
+}
+
+Profiler::GpuZone* Profiler::beginGpuZone(const char* name)
+{
+    if(!gpuTimers || !isEnabled()) return nullptr;
+
+    GpuZone zone;
+    zone.name = name;
+    zone.queries[0] = getQuery();
+    zone.queries[1] = getQuery();
+
+    glQueryCounter(zone.queries[0], GL_TIMESTAMP);
+
+    //a deque never moves its elements on push_back, the zone stays put until collected
+    gpuZones.push_back(zone);
+    return &gpuZones.back();
+}
+
+void Profiler::endGpuZone(GpuZone* zone)
+{
+    glQueryCounter(zone->queries[1], GL_TIMESTAMP);
+}
+
+void Profiler::collectGpuZones()
+{
+    if(gpuZones.empty()) return;
+
+    //GPU timestamps are on their own clock, line them up with ours
+    GLint64 gpuNow;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    int64_t offset = gpuNow - (int64_t)now();
+
+    while(!gpuZones.empty())
+    {
+        GpuZone& zone = gpuZones.front();
+
+        //zones finish in order, the first one that isn't done yet ends the batch
+        GLint available = 0;
+        glGetQueryObjectiv(zone.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if(!available) break;
+
+        GLuint64 start;
+        GLuint64 end;
+        glGetQueryObjectui64v(zone.queries[0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(zone.queries[1], GL_QUERY_RESULT, &end);
+
+        if(isEnabled()) record(zone.name, (int64_t)start - offset, (int64_t)end - offset, GPU_THREAD);
+
+        freeQueries.push_back(zone.queries[0]);
+        freeQueries.push_back(zone.queries[1]);
+        gpuZones.pop_front();
+    }
+}
+
+bool Profiler::writeChromeTrace(const std::string& path)
+{
+    std::vector<ProfileRecord> records;
+    uint64_t to = getWriteIndex();
+    readRecords(to > CAPACITY ? to - CAPACITY : 0, records);
+
+    FILE* file = fopen(path.c_str(), "w");
+    if(!file) return false;
+
+    //complete events in microseconds, one track per thread and one for the GPU
+    fprintf(file, "{\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"GPU\"}}", GPU_THREAD);
+    {
+        std::lock_guard<std::mutex> lock(threadNameMutex);
+        for(size_t i = 0; i < threadNames.size(); ++i)
+        {
+            if(threadNames[i].empty()) continue;
+            fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%zu,\"args\":{\"name\":", i);
+            writeJsonString(file, threadNames[i].c_str());
+            fprintf(file, "}}");
+        }
+    }
+
+    for(const ProfileRecord& record : records)
+    {
+        fprintf(file, ",\n{\"name\":");
+        writeJsonString(file, record.name);
+        fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                record.gpu ? "gpu" : "cpu", record.thread,
+                record.start / 1000.0, (record.end - record.start) / 1000.0);
+    }
+
+    fprintf(file, "\n]}\n");
+
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
@@ -0,0 +1,198 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+// A finished zone as read back out of the Profiler
+struct ProfileRecord
+{
+    const char* name;
+
+    //nanoseconds since the profiler started, GPU zones are moved onto the same clock
+    uint64_t start;
+    uint64_t end;
+
+    uint32_t thread;
+    bool gpu;
+};
+
+// Scoped CPU and GPU timing zones. PROFILE_SCOPE("name") times the rest of the
+// enclosing block on the calling thread, PROFILE_GPU_SCOPE("name") the GL
+// commands issued in it. Any thread can record; each finished zone is one slot
+// in a fixed size ring, claimed with an atomic increment, so recording never
+// locks or allocates. The oldest zones are overwritten once the ring is full;
+// a thread stalled for a whole lap of the ring can lose a newer zone that way.
+//
+// GPU zones are timestamp query pairs read back a few frames later in
+// beginFrame, they need the GL context. Names have to be string literals or
+// otherwise outlive the profiler.
+//
+// Build with -DPROFILER_DISABLED to compile every zone out, along with the
+// per frame and thread naming calls made through PROFILE_BEGIN_FRAME and
+// PROFILE_THREAD_NAME
+class Profiler
+{
+public:
+
+    //zones kept, a power of two
+    static const size_t CAPACITY = 1 << 16;
+
+    //the GPU track's thread id in records and traces
+    static const uint32_t GPU_THREAD = 0xffffffff;
+
+    struct GpuZone
+    {
+        const char* name;
+        GLuint queries[2];
+    };
+
+private:
+
+    // fields are relaxed atomics so a reader racing a writer gets a torn record
+    // it can detect through sequence instead of undefined behavior
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;
+        std::atomic<const char*> name;
+        std::atomic<uint64_t> start;
+        std::atomic<uint64_t> end;
+        std::atomic<uint32_t> thread;
+    };
+
+    Slot* slots;
+    std::atomic<uint64_t> writeIndex;
+
+    std::atomic<bool> enabled;
+    std::atomic<uint32_t> nextThread;
+
+    std::mutex threadNameMutex;
+    std::vector<std::string> threadNames;
+
+    //GL thread only
+    bool gpuChecked = false;
+    bool gpuTimers = false;
+    std::deque<GpuZone> gpuZones;
+    std::vector<GLuint> freeQueries;
+
+    Profiler();
+
+    GLuint getQuery();
+    void collectGpuZones();
+
+public:
+
+    ~Profiler();
+
+    static Profiler& get();
+
+    // zones are dropped while disabled, on by default
+    void setEnabled(bool enabled)
+    {
+        this->enabled = enabled;
+    }
+
+    bool isEnabled()
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    // nanoseconds since the profiler started
+    static uint64_t now();
+
+    // small id of the calling thread, handed out on first use
+    static uint32_t getThreadId();
+
+    // name shown for the calling thread in traces
+    void setThreadName(const std::string& name);
+
+    void record(const char* name, uint64_t start, uint64_t end, uint32_t thread);
+
+    // call once per frame on the GL thread, before any GPU zone of the frame.
+    // Checks for GPU timer support the first time
+    void beginFrame();
+
+    // nullptr when the context has no timer queries or the profiler is disabled
+    GpuZone* beginGpuZone(const char* name);
+    void endGpuZone(GpuZone* zone);
+
+    // index the next zone will be written at, pass it to readRecords later to get everything since
+    uint64_t getWriteIndex()
+    {
+        return writeIndex.load(std::memory_order_acquire);
+    }
+
+    // appends the zones recorded from index from on that are still in the ring,
+    // returns the index to continue from
+    uint64_t readRecords(uint64_t from, std::vector<ProfileRecord>& records);
+
+    // every zone still in the ring as Chrome trace event JSON (chrome://tracing, Perfetto).
+    // Returns false when the file can't be written
+    bool writeChromeTrace(const std::string& path);
+};
+
+class ProfileZone
+{
+private:
+    const char* name;
+    uint64_t start;
+    bool enabled;
+
+public:
+
+    explicit ProfileZone(const char* name)
+    {
+        this->name = name;
+
+        //disabled zones don't even read the clock
+        enabled = Profiler::get().isEnabled();
+        if(enabled) start = Profiler::now();
+    }
+
+    ~ProfileZone()
+    {
+        if(enabled) Profiler::get().record(name, start, Profiler::now(), Profiler::getThreadId());
+    }
+};
+
+class ProfileGpuZone
+{
+private:
+    Profiler::GpuZone* zone;
+
+public:
+
+    explicit ProfileGpuZone(const char* name)
+    {
+        zone = Profiler::get().beginGpuZone(name);
+    }
+
+    ~ProfileGpuZone()
+    {
+        if(zone) Profiler::get().endGpuZone(zone);
+    }
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef PROFILER_DISABLED
+#define PROFILE_SCOPE(name)
+#define PROFILE_GPU_SCOPE(name)
+#define PROFILE_BEGIN_FRAME()
+#define PROFILE_THREAD_NAME(name)
+#else
+#define PROFILE_SCOPE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) ProfileGpuZone PROFILE_CONCAT(profileGpuZone, __LINE__)(name)
+#define PROFILE_BEGIN_FRAME() Profiler::get().beginFrame()
+#define PROFILE_THREAD_NAME(name) Profiler::get().setThreadName(name)
+#endif
+
+#endif
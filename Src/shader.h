@@ -6,13 +6,36 @@
 #include <glm/glm.hpp>
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
 
+// The setters that take a name look the location up in a table filled in when
+// the program is linked, they never call glGetUniformLocation. Code that sets a
+// uniform every frame should keep the location from getUniformLocation and use
+// the setters that take a location instead
 class Shader
 {
+private:
+
+    struct UniformLocation
+    {
+        std::string name;
+        GLint location;
+
+        bool operator<(const UniformLocation& other) const
+        {
+            return name < other.name;
+        }
+    };
+
+    //active uniforms sorted by name
+    std::vector<UniformLocation> uniformLocations;
+
 public:
 
     unsigned int ID;
@@ -75,6 +98,41 @@ public:
         
         glDeleteShader(vertex);
         glDeleteShader(fragment);
+
+        cacheUniformLocations();
+    }
+
+    ~Shader()
+    {
+        glDeleteProgram(ID);
+    }
+
+    // -1 when the program has no active uniform of that name, setting it does nothing then
+    GLint getUniformLocation(const char* name) const
+    {
+        size_t first = 0;
+        size_t last = uniformLocations.size();
+        while(first < last)
+        {
+            size_t middle = (first + last) / 2;
+            int order = strcmp(uniformLocations[middle].name.c_str(), name);
+
+            if(order == 0) return uniformLocations[middle].location;
+
+            if(order < 0) first = middle + 1;
+            else last = middle;
+        }
+        return -1;
+    }
+
+    // points the uniform block at a glBindBufferBase binding, programs without the block ignore it
+    void bindUniformBlock(const char* name, GLuint binding) const
+    {
+        GLuint index = glGetUniformBlockIndex(ID, name);
+        if(index != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(ID, index, binding);
+        }
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -84,64 +142,124 @@ public:
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
+    void setBool(const char* name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        setBool(getUniformLocation(name), value);
+    }
+    void setBool(GLint location, bool value) const
+    {         
+        glUniform1i(location, (int)value); 
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
+    void setInt(const char* name, int value) const
+    { 
+        setInt(getUniformLocation(name), value);
+    }
+    void setInt(GLint location, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(location, value); 
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
+    void setFloat(const char* name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        setFloat(getUniformLocation(name), value);
+    }
+    void setFloat(GLint location, float value) const
+    { 
+        glUniform1f(location, value); 
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string &name, const glm::vec2 &value) const
+    void setVec2(const char* name, const glm::vec2 &value) const
+    { 
+        setVec2(getUniformLocation(name), value);
+    }
+    void setVec2(GLint location, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform2fv(location, 1, &value[0]); 
     }
-    void setVec2(const std::string &name, float x, float y) const
+    void setVec2(const char* name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        glUniform2f(getUniformLocation(name), x, y); 
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string &name, const glm::vec3 &value) const
+    void setVec3(const char* name, const glm::vec3 &value) const
+    { 
+        setVec3(getUniformLocation(name), value);
+    }
+    void setVec3(GLint location, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform3fv(location, 1, &value[0]); 
     }
-    void setVec3(const std::string &name, float x, float y, float z) const
+    void setVec3(const char* name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        glUniform3f(getUniformLocation(name), x, y, z); 
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string &name, const glm::vec4 &value) const
+    void setVec4(const char* name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        setVec4(getUniformLocation(name), value);
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w) const
+    void setVec4(GLint location, const glm::vec4 &value) const
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        glUniform4fv(location, 1, &value[0]); 
+    }
+    void setVec4(const char* name, float x, float y, float z, float w) const
+    { 
+        glUniform4f(getUniformLocation(name), x, y, z, w); 
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string &name, const glm::mat2 &mat) const
+    void setMat2(const char* name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string &name, const glm::mat3 &mat) const
+    void setMat3(const char* name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string &name, const glm::mat4 &mat) const
+    void setMat4(const char* name, const glm::mat4 &mat) const
+    {
+        setMat4(getUniformLocation(name), mat);
+    }
+    void setMat4(GLint location, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    // reads every active uniform's location once, after linking
+    // ------------------------------------------------------------------------
+    void cacheUniformLocations()
+    {
+        GLint numUniforms = 0;
+        GLint maxNameLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &numUniforms);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+        std::vector<char> name(maxNameLength + 1);
+        for(GLint i = 0; i < numUniforms; ++i)
+        {
+            GLsizei length = 0;
+            GLint size;
+            GLenum type;
+            glGetActiveUniform(ID, i, name.size(), &length, &size, &type, name.data());
+
+            //members of uniform blocks have no location
+            GLint location = glGetUniformLocation(ID, name.data());
+            if(location < 0) continue;
+
+            //arrays are reported as "name[0]", they can be set by either name
+            std::string uniformName(name.data(), length);
+            uniformLocations.push_back({ uniformName, location });
+            if(size > 1 && uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+            {
+                uniformLocations.push_back({ uniformName.substr(0, uniformName.size() - 3), location });
+            }
+        }
+
+        std::sort(uniformLocations.begin(), uniformLocations.end());
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(unsigned int shader, std::string type)
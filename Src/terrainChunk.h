@@ -1,115 +1,162 @@
 #ifndef TERRAIN_CHUNK_H
 #define TERRAIN_CHUNK_H
 
+#include <cstddef>
+#include <memory>
+#include <vector>
+
 #include <glad/glad.h>
 
 #include <glm/glm.hpp>
 
-#include "fastnoise/FastNoise.h"
+#include "chunkData.h"
+#include "terrainChunkArena.h"
+#include "terrainIndexBuffer.h"
 
-class TerrainChunk
+// GL copy of a TerrainIndexBuffer, shared by every resident chunk of that size.
+// Only used on the thread with the GL context
+class TerrainIndexBufferGPU
 {
 private:
-    
-    static int VALUES_PER_VERTEX;
-    
-    
-    GLuint VAO;
-    GLuint positionBuffer;
-    GLuint normalBuffer;
-    GLuint colorBuffer;
+    std::shared_ptr<TerrainIndexBuffer> indices;
 
     GLuint indexBuffer;
 
-    GLuint numVertices;
+    explicit TerrainIndexBufferGPU(std::shared_ptr<TerrainIndexBuffer> indices);
 
-    GLuint numIndices;
+public:
+    ~TerrainIndexBufferGPU();
 
-    int chunkPosX;
-    int chunkPosZ;
+    // uploads on first use, the buffer goes away with the last chunk that uses it
+    static std::shared_ptr<TerrainIndexBufferGPU> get(std::shared_ptr<TerrainIndexBuffer> indices);
 
-    glm::vec3 worldPosMin;
-    glm::vec3 worldPosMax;
+    GLuint getBuffer()
+    {
+        return indexBuffer;
+    }
 
-    bool createdOnGPU = false;
-    
-    //we want to keep this data on the CPU for bullet physics mesh
-    float* positions = nullptr;
-    float* normals = nullptr;
-    float* colors = nullptr;
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    GLenum getIndexType()
+    {
+        return indices->getIndexSize() == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    }
+};
 
-    int* indices = nullptr;
-    /////////////////////////////////////////////////////////////
+// A block of a chunk's CPU data and where in which GL buffer it has to end up
+struct ChunkUpload
+{
+    const void* source;
+    size_t size;
+    GLuint buffer;
+    size_t offset;
+};
 
-    float lerp(float a, float b, float t);
+// A chunk that is resident on the GPU. Owns the ChunkData it was uploaded from,
+// the CPU copy stays around for physics. The vertices live in a slot of the
+// TerrainChunkArena for the chunk's size. The constructor only allocates the GL
+// storage, a TerrainUploadQueue fills it before the chunk is drawn. Has to be
+// created and deleted on the thread with the GL context
+class TerrainChunk
+{
+private:
 
-    glm::vec3 generateVertexPosition(FastNoise& noise, int x, int z);
-    glm::vec3 generateVertexNormal(glm::vec3 A, glm::vec3 B, glm::vec3 C);
-    glm::vec3 generateVertexColor(glm::vec3 position);
+    ChunkData* data;
 
-    void pushToBuffer(float* buffer, int& index, glm::vec3 values);
+    std::shared_ptr<TerrainChunkArena> arena;
+    size_t arenaSlot;
 
-    void generateChunkTerrain(FastNoise& noise);
+    //per-instance GrassBlade records, only created when the chunk has grass
+    GLuint grassVAO = 0;
+    GLuint grassInstanceBuffer = 0;
+    GLuint numGrassBlades = 0;
 
-    
+    void createGrass();
 
 public:
-    static int NOISE_HEIGHT_SCALE;
-    static int TERRAIN_SIZE;
-    static int SPACE_BETWEEN_VERTICES;
 
-    TerrainChunk(FastNoise& noise, int chunkPosX, int chunkPosZ);
+    // takes ownership of data and allocates its GL storage
+    explicit TerrainChunk(ChunkData* data);
     ~TerrainChunk();
 
-    void createOnGPU();
+    static size_t getGPUMemoryUsage(int terrainSize);
 
-    float* getPositionBuffer()
+    // gives a chunk made without grass the grass scattered over its data since and
+    // uploads it right away, it doesn't go through a TerrainUploadQueue
+    void addGrass(GrassField* grass);
+
+    // copies that fill the chunk's GL storage, in order. The buffers can change
+    // when an arena grows, so ask again right before copying
+    void getUploads(std::vector<ChunkUpload>& uploads);
+
+    ChunkData* getData()
     {
-        return positions;
+        return data;
+    }
+
+    glm::vec3 getOrigin()
+    {
+        return data->getOrigin();
     }
 
     int getChunkX()
     {
-        return chunkPosX;
+        return data->getChunkX();
     }
 
     int getChunkZ()
     {
-        return chunkPosZ;
+        return data->getChunkZ();
     }
 
     glm::vec3 getWorldMin()
     {
-        return worldPosMin;
+        return data->getWorldMin();
     }
 
     glm::vec3 getWorldMax()
     {
-        return worldPosMax;
+        return data->getWorldMax();
+    }
+
+    // horizontal distance from pos to the closest point of the chunk
+    float getDistance(glm::vec3 pos)
+    {
+        glm::vec3 min = getOrigin();
+        glm::vec3 max = min + glm::vec3(data->getTerrainSize() + 1);
+
+        float dx = glm::max(glm::max(min.x - pos.x, 0.f), pos.x - max.x);
+        float dz = glm::max(glm::max(min.z - pos.z, 0.f), pos.z - max.z);
+
+        return glm::sqrt(dx * dx + dz * dz);
+    }
+
+    TerrainChunkArena* getArena()
+    {
+        return arena.get();
     }
 
-    GLuint getVertexArray()
+    // where the chunk's vertices start in the arena's vertex buffer
+    GLint getBaseVertex()
     {
-        return VAO;
+        return arena->getBaseVertex(arenaSlot);
     }
 
-    int* getIndexBuffer()
+    TerrainIndexBuffer* getIndexBuffer()
     {
-        return indices;
+        return data->getIndexBuffer();
     }
 
-    GLuint getNumVertices()
+    GLuint getGrassVertexArray()
     {
-        return numVertices;
+        return grassVAO;
     }
 
-    GLuint getNumIndices()
+    GLuint getNumGrassBlades()
     {
-        return numIndices;
+        return numGrassBlades;
     }
-    
 };
 
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,202 @@
+#include "terrainChunkArena.h"
+
+#include <map>
+
+#include "terrainChunk.h"
+
+TerrainChunkArena::TerrainChunkArena(std::shared_ptr<TerrainIndexBuffer> indices, uint32_t verticesPerChunk)
+{
+    this->verticesPerChunk = verticesPerChunk;
+
+    indexBuffer = TerrainIndexBufferGPU::get(indices);
+    multiDraw = supportsMultiDraw();
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &vertexBuffer);
+
+    grow();
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer->getBuffer());
+
+    if(multiDraw)
+    {
+        glGenBuffers(1, &drawDataBuffer);
+        glGenBuffers(1, &indirectBuffer);
+
+        //one instance per draw, baseInstance picks the draw's entry
+        glBindBuffer(GL_ARRAY_BUFFER, drawDataBuffer);
+
+        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(TerrainDrawData), (void*)offsetof(TerrainDrawData, originX));
+        glEnableVertexAttribArray(4);
+        glVertexAttribDivisor(4, 1);
+
+        glVertexAttribPointer(5, 2, GL_FLOAT, GL_FALSE, sizeof(TerrainDrawData), (void*)offsetof(TerrainDrawData, morphStart));
+        glEnableVertexAttribArray(5);
+        glVertexAttribDivisor(5, 1);
+
+        glVertexAttribIPointer(6, 2, GL_INT, sizeof(TerrainDrawData), (void*)offsetof(TerrainDrawData, lodLevel));
+        glEnableVertexAttribArray(6);
+        glVertexAttribDivisor(6, 1);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+TerrainChunkArena::~TerrainChunkArena()
+{
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &vertexBuffer);
+
+    if(multiDraw)
+    {
+        glDeleteBuffers(1, &drawDataBuffer);
+        glDeleteBuffers(1, &indirectBuffer);
+    }
+}
+
+std::shared_ptr<TerrainChunkArena> TerrainChunkArena::get(std::shared_ptr<TerrainIndexBuffer> indices, uint32_t verticesPerChunk)
+{
+    //GL thread only, so no lock
+    static std::map<TerrainIndexBuffer*, std::weak_ptr<TerrainChunkArena>> arenas;
+
+    std::shared_ptr<TerrainChunkArena> arena = arenas[indices.get()].lock();
+    if(!arena)
+    {
+        arena = std::shared_ptr<TerrainChunkArena>(new TerrainChunkArena(indices, verticesPerChunk));
+        arenas[indices.get()] = arena;
+    }
+
+    return arena;
+}
+
+bool TerrainChunkArena::supportsMultiDraw()
+{
+    //4.3 has both multi draw indirect and the base instance it relies on
+    return GLAD_GL_VERSION_4_3;
+}
+
+void TerrainChunkArena::setVertexAttributes()
+{
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+
+    //height, normalized to [0, 1]
+    glVertexAttribPointer(0, 1, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(TerrainVertex), (void*)offsetof(TerrainVertex, height));
+    glEnableVertexAttribArray(0);
+
+    //grid position, as is
+    glVertexAttribPointer(1, 2, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(TerrainVertex), (void*)offsetof(TerrainVertex, gridX));
+    glEnableVertexAttribArray(1);
+
+    //octahedral normal, normalized to [-1, 1]
+    glVertexAttribPointer(2, 2, GL_BYTE, GL_TRUE, sizeof(TerrainVertex), (void*)offsetof(TerrainVertex, normal));
+    glEnableVertexAttribArray(2);
+
+    //geomorph target height, normalized to [0, 1]
+    glVertexAttribPointer(3, 1, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(TerrainVertex), (void*)offsetof(TerrainVertex, morphHeight));
+    glEnableVertexAttribArray(3);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void TerrainChunkArena::grow()
+{
+    size_t chunkBytes = verticesPerChunk * sizeof(TerrainVertex);
+    size_t newSlots = numSlots == 0 ? INITIAL_SLOTS : numSlots * 2;
+
+    GLuint newBuffer;
+    glGenBuffers(1, &newBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, newSlots * chunkBytes, nullptr, GL_STATIC_DRAW);
+
+    //slots keep their place, so base vertices stay valid
+    if(numSlots > 0)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, vertexBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, numSlots * chunkBytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glDeleteBuffers(1, &vertexBuffer);
+    vertexBuffer = newBuffer;
+    numSlots = newSlots;
+
+    setVertexAttributes();
+}
+
+size_t TerrainChunkArena::allocate()
+{
+    size_t slot;
+    if(!freeSlots.empty())
+    {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else
+    {
+        if(nextSlot == numSlots) grow();
+        slot = nextSlot++;
+    }
+
+    return slot;
+}
+
+void TerrainChunkArena::release(size_t slot)
+{
+    freeSlots.push_back(slot);
+}
+
+GLenum TerrainChunkArena::getIndexType()
+{
+    return indexBuffer->getIndexType();
+}
+
+GLuint TerrainChunkArena::draw(const std::vector<TerrainDrawCommand>& commands, const std::vector<TerrainDrawData>& drawData)
+{
+    if(commands.empty()) return 0;
+
+    GLenum indexType = getIndexType();
+
+    glBindVertexArray(VAO);
+
+    if(multiDraw)
+    {
+        //orphaned every frame, the driver hands out fresh storage instead of waiting on the last frame
+        glBindBuffer(GL_ARRAY_BUFFER, drawDataBuffer);
+        glBufferData(GL_ARRAY_BUFFER, drawData.size() * sizeof(TerrainDrawData), drawData.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(TerrainDrawCommand), commands.data(), GL_STREAM_DRAW);
+
+        glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, nullptr, commands.size(), 0);
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindVertexArray(0);
+
+        return 1;
+    }
+
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    //attributes 4 to 6 have no array here, so the shader reads the current constant values
+    for(const TerrainDrawCommand& command : commands)
+    {
+        const TerrainDrawData& data = drawData[command.baseInstance];
+
+        glVertexAttrib4f(4, data.originX, data.originY, data.originZ, data.heightScale);
+        glVertexAttrib2f(5, data.morphStart, data.morphEnd);
+        glVertexAttribI4i(6, data.lodLevel, data.gridSize, 0, 0);
+
+        glDrawElementsBaseVertex(GL_TRIANGLES, command.count, indexType,
+                                 (void*)(command.firstIndex * indexSize), command.baseVertex);
+    }
+
+    glBindVertexArray(0);
+
+    return commands.size();
+}
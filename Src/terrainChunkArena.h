@@ -0,0 +1,130 @@
+#ifndef TERRAIN_CHUNK_ARENA_H
+#define TERRAIN_CHUNK_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "chunkData.h"
+#include "terrainIndexBuffer.h"
+
+class TerrainIndexBufferGPU;
+
+// What terrainPacked.vert needs to know about the chunk a draw belongs to.
+// Read as per-instance attributes 4 to 6, one instance per draw
+struct TerrainDrawData
+{
+    //attribute 4, world position of grid vertex (0, 0) and the chunk's height scale
+    float originX;
+    float originY;
+    float originZ;
+    float heightScale;
+
+    //attribute 5, distances over which the level's vertices morph towards the next one
+    float morphStart;
+    float morphEnd;
+
+    //attribute 6, LOD level and grid size
+    int32_t lodLevel;
+    int32_t gridSize;
+};
+
+// Same layout as the DrawElementsIndirectCommand glMultiDrawElementsIndirect reads
+struct TerrainDrawCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// One vertex buffer and VAO shared by every resident chunk of a size. Each chunk
+// gets a fixed size slot in the buffer and is drawn with its slot's base vertex,
+// all of them use the same TerrainIndexBufferGPU. The buffer doubles when it
+// runs out of slots. Slots are filled by the TerrainUploadQueue.
+//
+// draw submits a whole list of chunk draws. With GL 4.3 that is one
+// glMultiDrawElementsIndirect with the per-draw data as instanced attributes,
+// otherwise it falls back to a glDrawElementsBaseVertex per chunk with the
+// per-draw data set as constant attributes. Only used on the thread with the GL context
+class TerrainChunkArena
+{
+private:
+
+    std::shared_ptr<TerrainIndexBufferGPU> indexBuffer;
+
+    uint32_t verticesPerChunk;
+
+    GLuint VAO;
+    GLuint vertexBuffer;
+
+    GLuint drawDataBuffer = 0;
+    GLuint indirectBuffer = 0;
+
+    bool multiDraw;
+
+    size_t numSlots = 0;
+    size_t nextSlot = 0;
+    std::vector<size_t> freeSlots;
+
+    TerrainChunkArena(std::shared_ptr<TerrainIndexBuffer> indices, uint32_t verticesPerChunk);
+
+    //points attributes 0 to 3 at the current vertex buffer
+    void setVertexAttributes();
+
+    void grow();
+
+public:
+
+    static const size_t INITIAL_SLOTS = 64;
+
+    ~TerrainChunkArena();
+
+    // arena for chunks using these indices, created on first use and gone with the last chunk in it
+    static std::shared_ptr<TerrainChunkArena> get(std::shared_ptr<TerrainIndexBuffer> indices, uint32_t verticesPerChunk);
+
+    // whether the context can draw a whole list with one call
+    static bool supportsMultiDraw();
+
+    // reserves a slot for a chunk's vertices, its contents are undefined until uploaded
+    size_t allocate();
+    void release(size_t slot);
+
+    // changes when the arena grows, look it up right before copying into it
+    GLuint getVertexBuffer()
+    {
+        return vertexBuffer;
+    }
+
+    // byte offset of the slot in the vertex buffer
+    size_t getSlotOffset(size_t slot)
+    {
+        return slot * verticesPerChunk * sizeof(TerrainVertex);
+    }
+
+    GLint getBaseVertex(size_t slot)
+    {
+        return slot * verticesPerChunk;
+    }
+
+    GLuint getVertexArray()
+    {
+        return VAO;
+    }
+
+    GLenum getIndexType();
+
+    bool isMultiDraw()
+    {
+        return multiDraw;
+    }
+
+    // draws commands[i] with drawData[commands[i].baseInstance], returns the number of draw calls issued
+    GLuint draw(const std::vector<TerrainDrawCommand>& commands, const std::vector<TerrainDrawData>& drawData);
+};
+
+#endif
@@ -1,48 +1,64 @@
 #include "terrainChunkGenerator.h"
 
+#include "threadPool.h"
+
 #include <iostream>
 #include <vector>
 #include <future>
 
-#include <chrono>
-
 
-static TerrainChunk* generateChunk(FastNoise noise, int x, int z)
+std::vector<TerrainChunk*> generateChunks(int size, const WorldConfig& config)
 {
-    return new TerrainChunk(noise, x, z);
-}
+    ThreadPool& pool = ThreadPool::getShared();
+    std::vector<ChunkData*> chunks = generateChunkData(size, config, pool);
 
-std::vector<TerrainChunk*> generateChunks(int size)
-{
-    // Get starting timepoint 
-    auto start = std::chrono::high_resolution_clock::now(); 
+    std::vector<std::future<void>> futures;
+    futures.reserve(chunks.size());
+    for(ChunkData* data : chunks)
+    {
+        futures.push_back(pool.submit([&config, data]
+        {
+            data->scatterGrass(config.grass);
+        }));
+    }
 
     std::vector<TerrainChunk*> result;
+    for(size_t i = 0; i < chunks.size(); ++i)
+    {
+        futures[i].get();
+        result.push_back(new TerrainChunk(chunks[i]));
+    }
 
-    FastNoise noise;
-    noise.SetSeed(start.time_since_epoch().count());
+    return result;
+}
+
+std::vector<ChunkData*> generateChunkData(int size, const WorldConfig& config, ThreadPool& pool)
+{
+    std::vector<ChunkData*> result;
 
+    //one read-only noise instance shared by every job, it outlives them
+    //because we wait on all the futures below
+    FastNoise noise = config.createNoise();
 
-    std::vector<std::future<TerrainChunk*>> futures;
+    std::vector<std::future<ChunkData*>> futures;
+    futures.reserve(4 * size * size);
 
     for(int x = -size; x < size; ++x)
     {
         for(int z = -size; z < size; ++z)
         {
-            futures.push_back(std::async(generateChunk, noise, x, z));
+            futures.push_back(pool.submit([&config, &noise, x, z]
+            {
+                return new ChunkData(config, noise, x, z);
+            }));
         }
     }
 
+    result.reserve(futures.size());
     for(size_t i = 0; i < futures.size(); ++i)
     {
         result.push_back(futures[i].get());
     }
 
-    for(TerrainChunk* chunk : result)
-    {
-        chunk->createOnGPU();
-    }
-    
-
     return result;
-}
\ No newline at end of file
+}
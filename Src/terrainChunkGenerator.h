@@ -3,9 +3,18 @@
 
 
 #include <vector>
+#include "chunkData.h"
 #include "terrainChunk.h"
+#include "worldConfig.h"
 
-std::vector<TerrainChunk*> generateChunks(int size);
+class ThreadPool;
 
+// generates the (2 * size)^2 chunks around the origin and their grass on the shared pool and uploads them
+std::vector<TerrainChunk*> generateChunks(int size, const WorldConfig& config);
 
-#endif
\ No newline at end of file
+// terrain of the above on the given pool, needs no GL context. Grass is left to
+// ChunkData::scatterGrass. The result only depends on the config, not on the pool's thread count
+std::vector<ChunkData*> generateChunkData(int size, const WorldConfig& config, ThreadPool& pool);
+
+
+#endif
@@ -0,0 +1,368 @@
+#include "terrainCollision.h"
+
+#include <cassert>
+#include <memory>
+#include <utility>
+
+#include <bullet/BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h>
+
+#include "terrainIndexBuffer.h"
+
+// Chunks only keep packed vertices, so the collision mesh owns a float copy of the positions.
+// The indices are the chunk's shared index buffer, kept alive for as long as the mesh is
+class TerrainMeshInterface : public btTriangleIndexVertexArray
+{
+private:
+    std::vector<float> positions;
+    std::shared_ptr<TerrainIndexBuffer> indices;
+
+public:
+    TerrainMeshInterface(ChunkData* chunk)
+    {
+        addIndexedMesh(btIndexedMesh());
+        setChunk(chunk);
+    }
+
+    // points the mesh at the chunk's triangles, the positions keep their allocation when the size matches
+    void setChunk(ChunkData* chunk)
+    {
+        positions.resize(3 * chunk->getNumVertices());
+        chunk->decodePositions(positions.data());
+
+        indices = chunk->getSharedIndexBuffer();
+
+        btIndexedMesh& mesh = getIndexedMeshArray()[0];
+        mesh.m_numTriangles = indices->getNumIndices() / 3;
+        mesh.m_triangleIndexBase = indices->getData();
+        mesh.m_triangleIndexStride = 3 * indices->getIndexSize();
+        mesh.m_numVertices = chunk->getNumVertices();
+        mesh.m_vertexBase = (const unsigned char*)positions.data();
+        mesh.m_vertexStride = 3 * sizeof(float);
+        mesh.m_indexType = indices->getIndexSize() == sizeof(uint16_t) ? PHY_SHORT : PHY_INTEGER;
+        mesh.m_vertexType = PHY_FLOAT;
+    }
+
+    size_t getPositionBytes()
+    {
+        return positions.capacity() * sizeof(float);
+    }
+};
+
+// The BVH is either built or loaded in place out of bvhData, a serialized copy
+// from the collision cache. Loaded BVHs live inside that buffer and aren't owned
+// by the base class, which only frees the ones it built
+class TerrainMeshShape : public btBvhTriangleMeshShape
+{
+private:
+    btAlignedObjectArray<unsigned char> bvhData;
+
+    void dropBvh()
+    {
+        if(!m_bvh) return;
+
+        //a loaded BVH's arrays point into bvhData, its destructor frees nothing
+        m_bvh->~btOptimizedBvh();
+        if(m_ownsBvh) btAlignedFree(m_bvh);
+
+        m_bvh = nullptr;
+        m_ownsBvh = false;
+    }
+
+public:
+    // bounds come from the triangles, the BVH from buildBvh or loadBvh
+    TerrainMeshShape(TerrainMeshInterface* mesh)
+        : btBvhTriangleMeshShape(mesh, true, false)
+    {
+    }
+
+    ~TerrainMeshShape()
+    {
+        dropBvh();
+        delete getMeshInterface();
+    }
+
+    // the shape over another chunk's triangles with new bounds and no BVH yet
+    void setChunk(ChunkData* chunk)
+    {
+        dropBvh();
+        static_cast<TerrainMeshInterface*>(getMeshInterface())->setChunk(chunk);
+
+        recalcLocalAabb();
+    }
+
+    void buildBvh()
+    {
+        buildOptimizedBvh();
+    }
+
+    // false when the chunk's BVH isn't cached or doesn't deserialize
+    bool loadBvh(CollisionCache* cache, ChunkData* chunk)
+    {
+        if(!cache->load(chunk->getChunkX(), chunk->getChunkZ(), bvhData)) return false;
+
+        btOptimizedBvh* bvh = btOptimizedBvh::deSerializeInPlace(&bvhData[0], bvhData.size(), false);
+        if(!bvh) return false;
+
+        setOptimizedBvh(bvh);
+        return true;
+    }
+
+    // serializes the built BVH through bvhData, which only holds loaded BVHs otherwise
+    void storeBvh(CollisionCache* cache, ChunkData* chunk)
+    {
+        unsigned size = m_bvh->calculateSerializeBufferSize();
+        bvhData.resize(size);
+        if(m_bvh->serializeInPlace(&bvhData[0], size, false))
+        {
+            cache->store(chunk, &bvhData[0], size);
+        }
+    }
+
+    size_t getBvhBytes()
+    {
+        //loaded BVHs are in bvhData, built ones on the heap with about the size they serialize to
+        size_t bytes = bvhData.capacity();
+        if(m_ownsBvh) bytes += m_bvh->calculateSerializeBufferSize();
+        return bytes;
+    }
+};
+
+// btHeightfieldTerrainShape only references its data, this one holds it until
+// the collider takes it back for the next heightfield
+class TerrainHeightfieldShape : public btHeightfieldTerrainShape
+{
+private:
+    std::vector<float> heights;
+    int gridSize;
+
+public:
+    TerrainHeightfieldShape(std::vector<float>&& heights, int gridSize, float minHeight, float maxHeight)
+        : btHeightfieldTerrainShape(gridSize, gridSize, heights.data(), 1.f, minHeight, maxHeight, 1, PHY_FLOAT, true),
+          heights(std::move(heights))
+    {
+        this->gridSize = gridSize;
+
+        //the index buffer cuts every quad from (x, z) to (x + 1, z + 1),
+        //bullet's default is the other diagonal
+        setFlipQuadEdges(true);
+    }
+
+    std::vector<float> takeHeights()
+    {
+        return std::move(heights);
+    }
+
+    size_t getHeightBytes()
+    {
+        return heights.capacity() * sizeof(float);
+    }
+};
+
+const char* getTerrainCollisionBackendName(TerrainCollisionBackend backend)
+{
+    switch(backend)
+    {
+        case TERRAIN_COLLISION_BVH:
+            return "bvh";
+        case TERRAIN_COLLISION_HEIGHTFIELD:
+            return "heightfield";
+    }
+
+    return "unknown";
+}
+
+TerrainCollider::~TerrainCollider()
+{
+    assert(numLive == 0);
+    trim();
+}
+
+btCollisionShape* TerrainCollider::createMeshShape(ChunkData* chunk)
+{
+    TerrainMeshShape* shape = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(!freeMeshShapes.empty())
+        {
+            shape = freeMeshShapes.back();
+            freeMeshShapes.pop_back();
+        }
+    }
+
+    if(shape) shape->setChunk(chunk);
+    else shape = new TerrainMeshShape(new TerrainMeshInterface(chunk));
+
+    if(cache && shape->loadBvh(cache, chunk))
+    {
+        return shape;
+    }
+
+    shape->buildBvh();
+    if(cache) shape->storeBvh(cache, chunk);
+
+    return shape;
+}
+
+btCollisionShape* TerrainCollider::createHeightfieldShape(ChunkData* chunk)
+{
+    std::vector<float> heights;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(!freeHeights.empty())
+        {
+            heights = std::move(freeHeights.back());
+            freeHeights.pop_back();
+        }
+    }
+
+    int gridSize = chunk->getTerrainSize() + 2;
+    heights.resize(gridSize * gridSize);
+
+    //chunk vertices are stored x major, bullet wants x to be the fast axis
+    TerrainVertex* vertices = chunk->getVertexBuffer();
+    for(int i = 0; i < gridSize; ++i)
+    {
+        for(int j = 0; j < gridSize; ++j)
+        {
+            heights[j * gridSize + i] = chunk->decodeHeight(vertices[i * gridSize + j].height);
+        }
+    }
+
+    //a few dozen bytes on top of the heights, not worth keeping around
+    return new TerrainHeightfieldShape(std::move(heights), gridSize, chunk->getWorldMin().y, chunk->getWorldMax().y);
+}
+
+btRigidBody* TerrainCollider::createBody(btCollisionShape* shape, const btTransform& transform)
+{
+    btRigidBody* body = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        numLive++;
+
+        if(!freeBodies.empty())
+        {
+            body = freeBodies.back();
+            freeBodies.pop_back();
+        }
+    }
+
+    if(body)
+    {
+        btDefaultMotionState* motionState = static_cast<btDefaultMotionState*>(body->getMotionState());
+        motionState->m_startWorldTrans = transform;
+        motionState->setWorldTransform(transform);
+
+        body->setCollisionShape(shape);
+        body->setWorldTransform(transform);
+        body->setInterpolationWorldTransform(transform);
+        return body;
+    }
+
+    //using motionstate is recommended, it provides interpolation capabilities, and only synchronizes 'active' objects
+    btDefaultMotionState* myMotionState = new btDefaultMotionState(transform);
+    btRigidBody::btRigidBodyConstructionInfo rbInfo(0.f,myMotionState,shape,btVector3(0,0,0));
+    body = new btRigidBody(rbInfo);
+
+    body->setCollisionFlags(body->getCollisionFlags() | btCollisionObject::CF_KINEMATIC_OBJECT);
+
+    return body;
+}
+
+btRigidBody* TerrainCollider::create(ChunkData* chunk, TerrainCollisionBackend backend)
+{
+    btCollisionShape* shape;
+
+    btTransform startTransform;
+    startTransform.setIdentity();
+
+    if(backend == TERRAIN_COLLISION_HEIGHTFIELD)
+    {
+        shape = createHeightfieldShape(chunk);
+
+        //the heightfield is centered on its local origin, both horizontally and between min and max height
+        glm::vec3 origin = chunk->getOrigin();
+        float extent = (chunk->getTerrainSize() + 1) / 2.f;
+        startTransform.setOrigin(btVector3(origin.x + extent,
+                                           (chunk->getWorldMin().y + chunk->getWorldMax().y) / 2.f,
+                                           origin.z + extent));
+    }
+    else
+    {
+        shape = createMeshShape(chunk);
+    }
+
+    return createBody(shape, startTransform);
+}
+
+void TerrainCollider::release(btRigidBody* body)
+{
+    btCollisionShape* shape = body->getCollisionShape();
+    body->setCollisionShape(nullptr);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    numLive--;
+
+    freeBodies.push_back(body);
+
+    if(shape->getShapeType() == TERRAIN_SHAPE_PROXYTYPE)
+    {
+        TerrainHeightfieldShape* heightfield = static_cast<TerrainHeightfieldShape*>(shape);
+        freeHeights.push_back(heightfield->takeHeights());
+        delete heightfield;
+    }
+    else
+    {
+        freeMeshShapes.push_back(static_cast<TerrainMeshShape*>(shape));
+    }
+}
+
+void TerrainCollider::trim()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for(btRigidBody* body : freeBodies)
+    {
+        delete body->getMotionState();
+        delete body;
+    }
+    freeBodies.clear();
+
+    for(TerrainMeshShape* shape : freeMeshShapes)
+    {
+        delete shape;
+    }
+    freeMeshShapes.clear();
+
+    freeHeights.clear();
+}
+
+size_t TerrainCollider::getMemoryUsage(btRigidBody* body)
+{
+    btCollisionShape* shape = body->getCollisionShape();
+
+    if(shape->getShapeType() == TERRAIN_SHAPE_PROXYTYPE)
+    {
+        TerrainHeightfieldShape* heightfield = static_cast<TerrainHeightfieldShape*>(shape);
+        return sizeof(TerrainHeightfieldShape) + heightfield->getHeightBytes();
+    }
+
+    TerrainMeshShape* mesh = static_cast<TerrainMeshShape*>(shape);
+    TerrainMeshInterface* meshInterface = static_cast<TerrainMeshInterface*>(mesh->getMeshInterface());
+
+    //the index buffer is shared with rendering, only the positions and the BVH are extra
+    return sizeof(TerrainMeshShape) + sizeof(TerrainMeshInterface) +
+           meshInterface->getPositionBytes() +
+           mesh->getBvhBytes();
+}
+
+size_t TerrainCollider::getNumLive()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return numLive;
+}
+
+size_t TerrainCollider::getNumPooled()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return freeBodies.size() + freeMeshShapes.size() + freeHeights.size();
+}
@@ -0,0 +1,89 @@
+#ifndef TERRAIN_COLLISION_H
+#define TERRAIN_COLLISION_H
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include <bullet/btBulletDynamicsCommon.h>
+
+#include "chunkData.h"
+#include "collisionCache.h"
+
+// How a chunk is represented in the physics world. Both match the rendered
+// triangles, the heightfield splits its quads along the index buffer's
+// diagonal; it keeps only the height grid and needs no BVH
+enum TerrainCollisionBackend
+{
+    TERRAIN_COLLISION_BVH,
+    TERRAIN_COLLISION_HEIGHTFIELD
+};
+
+const char* getTerrainCollisionBackendName(TerrainCollisionBackend backend);
+
+class TerrainMeshShape;
+class TerrainHeightfieldShape;
+
+// Owns every Bullet object behind the terrain bodies: the rigid body, its motion
+// state, the shape and the data the shape reads. Released bodies and shapes go
+// into free lists and are rebuilt in place for the next chunk, so terrain that
+// streams in and out keeps reusing the same allocations. The free lists never
+// hold more than the most bodies that were alive at once.
+//
+// With a CollisionCache, mesh shapes take their BVH out of it when the chunk has
+// been seen before and store the one they build otherwise.
+// create and release can be called from any thread
+class TerrainCollider
+{
+private:
+
+    std::mutex mutex;
+
+    //bodies keep their motion state, mesh shapes their mesh and its positions
+    std::vector<btRigidBody*> freeBodies;
+    std::vector<TerrainMeshShape*> freeMeshShapes;
+    std::vector<std::vector<float>> freeHeights;
+
+    size_t numLive = 0;
+
+    CollisionCache* cache = nullptr;
+
+    btCollisionShape* createMeshShape(ChunkData* chunk);
+    btCollisionShape* createHeightfieldShape(ChunkData* chunk);
+    btRigidBody* createBody(btCollisionShape* shape, const btTransform& transform);
+
+public:
+
+    TerrainCollider() = default;
+    TerrainCollider(const TerrainCollider&) = delete;
+    TerrainCollider& operator=(const TerrainCollider&) = delete;
+
+    // every body has to be released by now
+    ~TerrainCollider();
+
+    // BVHs are loaded from and stored to the cache from now on, nullptr builds every one.
+    // Set it before the first create
+    void setCache(CollisionCache* cache)
+    {
+        this->cache = cache;
+    }
+
+    // static body for the chunk, only reads the chunk while building so it is safe on a worker thread
+    btRigidBody* create(ChunkData* chunk, TerrainCollisionBackend backend);
+
+    // takes back a body made by create, it has to be out of its world
+    void release(btRigidBody* body);
+
+    // frees everything in the free lists
+    void trim();
+
+    // approximate bytes held by the body's shape and its data
+    static size_t getMemoryUsage(btRigidBody* body);
+
+    size_t getNumLive();
+
+    // bodies, mesh shapes and height grids waiting to be reused
+    size_t getNumPooled();
+};
+
+#endif
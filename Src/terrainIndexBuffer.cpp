@@ -0,0 +1,207 @@
+#include "terrainIndexBuffer.h"
+
+#include <map>
+#include <mutex>
+
+struct GridPoint
+{
+    int x;
+    int z;
+};
+
+// keeps the winding of the full resolution mesh, whatever order the points came in
+static void pushTriangle(std::vector<uint32_t>& out, int gridSize, GridPoint a, GridPoint b, GridPoint c)
+{
+    int cross = (b.x - a.x) * (c.z - a.z) - (b.z - a.z) * (c.x - a.x);
+    if(cross > 0) std::swap(b, c);
+
+    out.push_back(a.x * gridSize + a.z);
+    out.push_back(b.x * gridSize + b.z);
+    out.push_back(c.x * gridSize + c.z);
+}
+
+// triangulates the strip between a full resolution edge and the coarse ring inside it,
+// both given in order along the edge with t being the position along it
+static void pushStrip(std::vector<uint32_t>& out, int gridSize,
+                      const std::vector<GridPoint>& outer, const std::vector<int>& outerT,
+                      const std::vector<GridPoint>& inner, const std::vector<int>& innerT)
+{
+    size_t a = 0;
+    size_t b = 0;
+    while(a + 1 < outer.size() || b + 1 < inner.size())
+    {
+        bool advanceOuter = b + 1 == inner.size() || 
+                            (a + 1 < outer.size() && outerT[a + 1] <= innerT[b + 1]);
+        if(advanceOuter)
+        {
+            pushTriangle(out, gridSize, outer[a], outer[a + 1], inner[b]);
+            a++;
+        }
+        else
+        {
+            pushTriangle(out, gridSize, outer[a], inner[b + 1], inner[b]);
+            b++;
+        }
+    }
+}
+
+TerrainIndexBuffer::TerrainIndexBuffer(int size)
+{
+    this->size = size;
+
+    std::vector<std::vector<uint32_t>> levels;
+    levels.push_back(generateLevel(0));
+
+    //a level needs at least one coarse quad inside the full resolution ring
+    for(int level = 1; level < MAX_LOD_LEVELS; ++level)
+    {
+        if(getLevelLines(size, level).size() < 4) break;
+        levels.push_back(generateLevel(level));
+    }
+    numLevels = levels.size();
+
+    if((size + 2) * (size + 2) <= 65536)
+    {
+        indexSize = sizeof(uint16_t);
+        generateIndices<uint16_t>(levels);
+    }
+    else
+    {
+        indexSize = sizeof(uint32_t);
+        generateIndices<uint32_t>(levels);
+    }
+}
+
+std::vector<int> TerrainIndexBuffer::getLevelLines(int size, int level)
+{
+    int last = size + 1;
+    int step = 1 << level;
+
+    std::vector<int> lines;
+    lines.push_back(0);
+    for(int line = step; line < last; line += step)
+    {
+        lines.push_back(line);
+    }
+    lines.push_back(last);
+
+    return lines;
+}
+
+std::vector<uint32_t> TerrainIndexBuffer::generateLevel(int level)
+{
+    int gridSize = size + 2;
+    std::vector<uint32_t> out;
+
+    if(level == 0)
+    {
+        for(int i = 0; i < size + 1; ++i)
+        {
+            for(int j = 0; j < size + 1; ++j)
+            {
+                out.push_back(i * gridSize + j);
+                out.push_back(i * gridSize + j + 1);
+                out.push_back((i + 1) * gridSize + j + 1);
+
+                out.push_back(i * gridSize + j);
+                out.push_back((i + 1) * gridSize + j + 1);
+                out.push_back((i + 1) * gridSize + j);
+            }
+        }
+
+        return out;
+    }
+
+    //coarse lines strictly inside the edges
+    std::vector<int> lines = getLevelLines(size, level);
+    std::vector<int> inner(lines.begin() + 1, lines.end() - 1);
+
+    //coarse interior, same diagonal as the full resolution mesh
+    for(size_t a = 0; a + 1 < inner.size(); ++a)
+    {
+        for(size_t b = 0; b + 1 < inner.size(); ++b)
+        {
+            GridPoint p00 = { inner[a],     inner[b] };
+            GridPoint p01 = { inner[a],     inner[b + 1] };
+            GridPoint p11 = { inner[a + 1], inner[b + 1] };
+            GridPoint p10 = { inner[a + 1], inner[b] };
+
+            pushTriangle(out, gridSize, p00, p01, p11);
+            pushTriangle(out, gridSize, p00, p11, p10);
+        }
+    }
+
+    //stitch the full resolution edges to the coarse ring, one strip per side
+    int last = size + 1;
+    int lo = inner.front();
+    int hi = inner.back();
+
+    std::vector<int> outerT;
+    for(int t = 0; t <= last; ++t)
+    {
+        outerT.push_back(t);
+    }
+
+    int edgeLines[2] = { 0, last };
+    int ringLines[2] = { lo, hi };
+    for(int side = 0; side < 2; ++side)
+    {
+        std::vector<GridPoint> outerX, innerX, outerZ, innerZ;
+        for(int t : outerT)
+        {
+            outerX.push_back({ edgeLines[side], t });
+            outerZ.push_back({ t, edgeLines[side] });
+        }
+        for(int t : inner)
+        {
+            innerX.push_back({ ringLines[side], t });
+            innerZ.push_back({ t, ringLines[side] });
+        }
+
+        pushStrip(out, gridSize, outerX, outerT, innerX, inner);
+        pushStrip(out, gridSize, outerZ, outerT, innerZ, inner);
+    }
+
+    return out;
+}
+
+template<typename T>
+void TerrainIndexBuffer::generateIndices(const std::vector<std::vector<uint32_t>>& levels)
+{
+    numIndices = 0;
+    for(int level = 0; level < numLevels; ++level)
+    {
+        levelOffsets[level] = numIndices;
+        levelCounts[level] = levels[level].size();
+        numIndices += levels[level].size();
+    }
+
+    indices.resize(numIndices * sizeof(T));
+    T* out = (T*)indices.data();
+
+    for(const std::vector<uint32_t>& level : levels)
+    {
+        for(uint32_t index : level)
+        {
+            *out++ = index;
+        }
+    }
+}
+
+std::shared_ptr<TerrainIndexBuffer> TerrainIndexBuffer::get(int size)
+{
+    //weak so the buffer goes away with the last chunk that uses it
+    static std::mutex mutex;
+    static std::map<int, std::weak_ptr<TerrainIndexBuffer>> buffers;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::shared_ptr<TerrainIndexBuffer> buffer = buffers[size].lock();
+    if(!buffer)
+    {
+        buffer = std::shared_ptr<TerrainIndexBuffer>(new TerrainIndexBuffer(size));
+        buffers[size] = buffer;
+    }
+
+    return buffer;
+}
@@ -0,0 +1,85 @@
+#ifndef TERRAIN_INDEX_BUFFER_H
+#define TERRAIN_INDEX_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Triangle lists over a (size + 2)^2 chunk vertex grid. The topology only depends
+// on the chunk size, so every chunk of a size shares one of these. Indices are
+// 16 bit whenever the vertex count fits. This is only the CPU side, nothing here
+// touches GL; TerrainIndexBufferGPU uploads it for the renderer.
+//
+// Every LOD level lives in the same buffer, level 0 first. Level L keeps every
+// 2^L-th grid line in the interior but the outer edge stays at full resolution,
+// so neighbouring chunks always meet on identical edges whatever their levels
+class TerrainIndexBuffer
+{
+public:
+    static const int MAX_LOD_LEVELS = 5;
+
+private:
+
+    int size;
+    int numLevels;
+
+    uint32_t levelOffsets[MAX_LOD_LEVELS];
+    uint32_t levelCounts[MAX_LOD_LEVELS];
+    uint32_t numIndices;
+    size_t indexSize;
+
+    //raw index data, numIndices elements of getIndexSize() bytes
+    std::vector<unsigned char> indices;
+
+    template<typename T>
+    void generateIndices(const std::vector<std::vector<uint32_t>>& levels);
+
+    std::vector<uint32_t> generateLevel(int level);
+
+    explicit TerrainIndexBuffer(int size);
+
+public:
+
+    // returns the buffer for chunks of this size, creating it when no chunk holds it anymore.
+    // safe to call from worker threads
+    static std::shared_ptr<TerrainIndexBuffer> get(int size);
+
+    // grid lines kept at a level in one axis, ascending. Always includes both edges
+    static std::vector<int> getLevelLines(int size, int level);
+
+    int getNumLevels()
+    {
+        return numLevels;
+    }
+
+    // level 0 is the full resolution mesh at the start of the buffer
+    uint32_t getNumIndices(int level = 0)
+    {
+        return levelCounts[level];
+    }
+
+    // in indices, not bytes
+    uint32_t getOffset(int level)
+    {
+        return levelOffsets[level];
+    }
+
+    // bytes per index, 2 or 4
+    size_t getIndexSize()
+    {
+        return indexSize;
+    }
+
+    size_t getNumBytes()
+    {
+        return indices.size();
+    }
+
+    const unsigned char* getData()
+    {
+        return indices.data();
+    }
+};
+
+#endif
@@ -0,0 +1,189 @@
+#include "terrainUploadQueue.h"
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+TerrainUploadQueue::TerrainUploadQueue(size_t bytesPerFrame)
+{
+    this->bytesPerFrame = bytesPerFrame;
+
+    persistent = supportsPersistentMapping();
+    if(!persistent) return;
+
+    size_t ringSize = FRAMES_IN_FLIGHT * bytesPerFrame;
+
+    //coherent, so writes are visible to the copies without flushing
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenBuffers(1, &ringBuffer);
+    glBindBuffer(GL_COPY_READ_BUFFER, ringBuffer);
+    glBufferStorage(GL_COPY_READ_BUFFER, ringSize, nullptr, flags);
+    ringData = (unsigned char*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, ringSize, flags);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    //the driver said yes but couldn't map it, glBufferSubData still works
+    if(!ringData)
+    {
+        glDeleteBuffers(1, &ringBuffer);
+        ringBuffer = 0;
+        persistent = false;
+    }
+}
+
+TerrainUploadQueue::~TerrainUploadQueue()
+{
+    for(GLsync fence : fences)
+    {
+        if(fence) glDeleteSync(fence);
+    }
+
+    if(ringBuffer)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, ringBuffer);
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+        glDeleteBuffers(1, &ringBuffer);
+    }
+}
+
+bool TerrainUploadQueue::supportsPersistentMapping()
+{
+    //glBufferStorage is core in 4.4, the loader doesn't pull in ARB_buffer_storage
+    return GLAD_GL_VERSION_4_4;
+}
+
+void TerrainUploadQueue::push(TerrainChunk* chunk)
+{
+    uploads.clear();
+    chunk->getUploads(uploads);
+
+    size_t total = 0;
+    for(const ChunkUpload& upload : uploads)
+    {
+        total += upload.size;
+    }
+
+    pending.push_back({ chunk, 0, total });
+    pendingBytes += total;
+}
+
+void TerrainUploadQueue::cancel(TerrainChunk* chunk)
+{
+    for(auto it = pending.begin(); it != pending.end(); ++it)
+    {
+        if(it->chunk == chunk)
+        {
+            pendingBytes -= it->total - it->uploaded;
+            pending.erase(it);
+            return;
+        }
+    }
+}
+
+void TerrainUploadQueue::copy(const ChunkUpload& upload, size_t start, size_t size, size_t ringOffset)
+{
+    const unsigned char* source = (const unsigned char*)upload.source + start;
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, upload.buffer);
+
+    if(persistent)
+    {
+        memcpy(ringData + ringOffset, source, size);
+
+        glBindBuffer(GL_COPY_READ_BUFFER, ringBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, ringOffset, upload.offset + start, size);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    else
+    {
+        glBufferSubData(GL_COPY_WRITE_BUFFER, upload.offset + start, size, source);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+bool TerrainUploadQueue::acquireRegion(bool wait)
+{
+    GLsync& fence = fences[frame];
+    if(!persistent || !fence) return true;
+
+    //the fence was set FRAMES_IN_FLIGHT uploading frames ago, it has almost always passed
+    GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while(wait && status == GL_TIMEOUT_EXPIRED)
+    {
+        status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    }
+
+    if(status == GL_TIMEOUT_EXPIRED) return false;
+
+    glDeleteSync(fence);
+    fence = nullptr;
+    return true;
+}
+
+void TerrainUploadQueue::process(bool wait, std::vector<TerrainChunk*>& finished)
+{
+    if(pending.empty() || !acquireRegion(wait)) return;
+
+    size_t regionStart = frame * bytesPerFrame;
+    size_t used = 0;
+
+    while(!pending.empty() && used < bytesPerFrame)
+    {
+        PendingUpload& item = pending.front();
+
+        uploads.clear();
+        item.chunk->getUploads(uploads);
+
+        //carry on where the last frame stopped
+        size_t skip = item.uploaded;
+        for(const ChunkUpload& upload : uploads)
+        {
+            if(skip >= upload.size)
+            {
+                skip -= upload.size;
+                continue;
+            }
+
+            size_t size = std::min(upload.size - skip, bytesPerFrame - used);
+            copy(upload, skip, size, regionStart + used);
+
+            used += size;
+            item.uploaded += size;
+            skip = 0;
+
+            if(used == bytesPerFrame) break;
+        }
+
+        if(item.uploaded == item.total)
+        {
+            finished.push_back(item.chunk);
+            pending.pop_front();
+        }
+    }
+
+    pendingBytes -= used;
+
+    if(persistent)
+    {
+        fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        frame = (frame + 1) % FRAMES_IN_FLIGHT;
+    }
+}
+
+void TerrainUploadQueue::update(std::vector<TerrainChunk*>& finished)
+{
+    PROFILE_SCOPE("upload");
+    process(false, finished);
+}
+
+void TerrainUploadQueue::flush(std::vector<TerrainChunk*>& finished)
+{
+    while(!pending.empty())
+    {
+        process(true, finished);
+    }
+}
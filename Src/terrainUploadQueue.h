@@ -0,0 +1,100 @@
+#ifndef TERRAIN_UPLOAD_QUEUE_H
+#define TERRAIN_UPLOAD_QUEUE_H
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "terrainChunk.h"
+
+// Fills the GL storage of new chunks a bounded number of bytes per frame, so
+// streaming never stalls a frame on one big upload. Chunks are handed over as
+// soon as their generation finishes and come back from update once all of their
+// data has been copied, chunks larger than the budget take several frames.
+//
+// With GL 4.4 the data goes through a persistently mapped
+// staging ring. The ring has one region of bytesPerFrame per frame in flight, a
+// frame's copies are fenced and its region is only written again once the GPU
+// is done with it. A frame whose region is still busy uploads nothing instead
+// of waiting. Without persistent mapping every copy is a glBufferSubData.
+// Only used on the thread with the GL context
+class TerrainUploadQueue
+{
+public:
+
+    static const int FRAMES_IN_FLIGHT = 3;
+
+    //about two chunks of the default size with their grass
+    static const size_t DEFAULT_BYTES_PER_FRAME = 1 << 20;
+
+private:
+
+    struct PendingUpload
+    {
+        TerrainChunk* chunk;
+        size_t uploaded;
+        size_t total;
+    };
+
+    size_t bytesPerFrame;
+    bool persistent;
+
+    GLuint ringBuffer = 0;
+    unsigned char* ringData = nullptr;
+
+    GLsync fences[FRAMES_IN_FLIGHT] = {};
+    int frame = 0;
+
+    std::deque<PendingUpload> pending;
+    size_t pendingBytes = 0;
+
+    //scratch for TerrainChunk::getUploads
+    std::vector<ChunkUpload> uploads;
+
+    void copy(const ChunkUpload& upload, size_t start, size_t size, size_t ringOffset);
+
+    //false when the frame's ring region is still in use and wait is false
+    bool acquireRegion(bool wait);
+
+    void process(bool wait, std::vector<TerrainChunk*>& finished);
+
+public:
+
+    explicit TerrainUploadQueue(size_t bytesPerFrame = DEFAULT_BYTES_PER_FRAME);
+    ~TerrainUploadQueue();
+
+    // whether the context can keep the staging ring mapped
+    static bool supportsPersistentMapping();
+
+    bool isPersistent()
+    {
+        return persistent;
+    }
+
+    // the chunk and its data have to stay alive until it comes back from update or is cancelled
+    void push(TerrainChunk* chunk);
+
+    // drops a chunk that is deleted before it finished, copies already issued are harmless
+    void cancel(TerrainChunk* chunk);
+
+    // issues up to bytesPerFrame of copies, call once per frame. Chunks whose data
+    // is all on the GPU are appended to finished and can be drawn from now on
+    void update(std::vector<TerrainChunk*>& finished);
+
+    // issues everything left regardless of the budget, waiting on the GPU when the ring is full
+    void flush(std::vector<TerrainChunk*>& finished);
+
+    size_t getNumPending()
+    {
+        return pending.size();
+    }
+
+    size_t getPendingBytes()
+    {
+        return pendingBytes;
+    }
+};
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed-size work-stealing pool. Every worker owns a deque: it pops its own work
+// from the back and steals from the front of the other workers' deques when it
+// runs dry. Jobs submitted from outside the pool are spread round-robin.
+class ThreadPool
+{
+private:
+
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+
+    std::atomic<int> pending;
+    std::atomic<unsigned int> nextQueue;
+    std::atomic<bool> stopping;
+
+    // which pool/worker the calling thread belongs to, if any
+    static ThreadPool*& localPool()
+    {
+        static thread_local ThreadPool* pool = nullptr;
+        return pool;
+    }
+
+    static int& localIndex()
+    {
+        static thread_local int index = -1;
+        return index;
+    }
+
+    void push(std::function<void()> task)
+    {
+        unsigned int index;
+        if(localPool() == this)
+        {
+            index = localIndex();
+        }
+        else
+        {
+            index = nextQueue++ % queues.size();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        pending++;
+
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        wake.notify_one();
+    }
+
+    bool pop(int index, std::function<void()>& task)
+    {
+        {
+            WorkQueue& own = *queues[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if(!own.tasks.empty())
+            {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                pending--;
+                return true;
+            }
+        }
+
+        for(size_t i = 1; i < queues.size(); ++i)
+        {
+            WorkQueue& victim = *queues[(index + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if(!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                pending--;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void workerLoop(int index)
+    {
+        localPool() = this;
+        localIndex() = index;
+
+        std::function<void()> task;
+        while(true)
+        {
+            if(pop(index, task))
+            {
+                task();
+                task = nullptr;
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this]{ return stopping || pending > 0; });
+
+            if(stopping && pending == 0) return;
+        }
+    }
+
+public:
+
+    explicit ThreadPool(unsigned int numThreads = std::thread::hardware_concurrency())
+        : pending(0), nextQueue(0), stopping(false)
+    {
+        if(numThreads == 0) numThreads = 1;
+
+        for(unsigned int i = 0; i < numThreads; ++i)
+        {
+            queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+        }
+
+        for(unsigned int i = 0; i < numThreads; ++i)
+        {
+            workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+        }
+    }
+
+    // finishes every queued job before joining
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+
+        for(std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    template<typename F>
+    std::future<typename std::result_of<F()>::type> submit(F func)
+    {
+        typedef typename std::result_of<F()>::type Result;
+
+        // std::function needs a copyable target, packaged_task is move only
+        std::shared_ptr<std::packaged_task<Result()>> task =
+            std::make_shared<std::packaged_task<Result()>>(std::move(func));
+
+        std::future<Result> result = task->get_future();
+        push([task]{ (*task)(); });
+
+        return result;
+    }
+
+    unsigned int getNumThreads()
+    {
+        return workers.size();
+    }
+
+    // process wide pool sized to the hardware, used by terrain generation and physics
+    static ThreadPool& getShared()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+};
+
+#endif
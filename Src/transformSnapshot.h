@@ -0,0 +1,104 @@
+#ifndef TRANSFORM_SNAPSHOT_H
+#define TRANSFORM_SNAPSHOT_H
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+#include <bullet/btBulletDynamicsCommon.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// A body's pose as of the last two physics ticks, written by the physics thread
+// after every tick and read by the render thread. Readers get a pose blended
+// between the two by how far past the newest tick they ask, so motion stays
+// smooth when the frame rate and the tick rate differ. What is drawn is one
+// tick behind the simulation
+class TransformSnapshot
+{
+private:
+
+    struct Pose
+    {
+        glm::vec3 position;
+        glm::quat rotation;
+        double time;
+    };
+
+    //only held to copy a pose in or out
+    std::mutex mutex;
+    Pose previous;
+    Pose current;
+
+    static Pose toPose(const btTransform& transform, double time)
+    {
+        const btVector3& origin = transform.getOrigin();
+        btQuaternion rotation = transform.getRotation();
+
+        Pose pose = { glm::vec3(origin.getX(), origin.getY(), origin.getZ()),
+                      glm::quat(rotation.getW(), rotation.getX(), rotation.getY(), rotation.getZ()),
+                      time };
+        return pose;
+    }
+
+    Pose interpolate(double time)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        Pose from = previous;
+        Pose to = current;
+        lock.unlock();
+
+        double length = to.time - from.time;
+        if(length <= 0.0) return to;
+
+        //a tick lands somewhere within its length of a frame, running the pose one tick
+        //late always leaves a newer one to move towards. Stalled ticks hold the newest pose
+        float alpha = (float)std::min(std::max((time - to.time) / length, 0.0), 1.0);
+
+        Pose pose = { glm::mix(from.position, to.position, alpha), glm::slerp(from.rotation, to.rotation, alpha), time };
+        return pose;
+    }
+
+public:
+
+    TransformSnapshot() : previous{ glm::vec3(0.f), glm::quat(1.f, 0.f, 0.f, 0.f), 0.0 }, current(previous)
+    {
+    }
+
+    // seconds on the clock ticks and readers agree on
+    static double now()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // both ticks at the transform, for bodies that are placed rather than simulated
+    void reset(const btTransform& transform, double time)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        previous = current = toPose(transform, time);
+    }
+
+    // the transform after the tick simulated up to time
+    void publish(const btTransform& transform, double time)
+    {
+        Pose pose = toPose(transform, time);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        previous = current;
+        current = pose;
+    }
+
+    glm::mat4 getTransform(double time)
+    {
+        Pose pose = interpolate(time);
+        return glm::translate(glm::mat4(1.f), pose.position) * glm::mat4_cast(pose.rotation);
+    }
+
+    glm::vec3 getPosition(double time)
+    {
+        return interpolate(time).position;
+    }
+};
+
+#endif
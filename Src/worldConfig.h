@@ -0,0 +1,98 @@
+#ifndef WORLD_CONFIG_H
+#define WORLD_CONFIG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "fastnoise/FastNoise.h"
+
+// One layer of the terrain height noise. Sampled at scale times the world
+// position, its [0, 1] value is weighted into the height
+struct NoiseOctave
+{
+    float scale;
+    float weight;
+};
+
+// Where grass grows and what the blades look like. Heights are fractions of
+// WorldConfig::heightScale, slopes are rise over run
+struct GrassConfig
+{
+    //candidate blades per grid cell, the density function thins them out
+    float bladesPerCell = 2.f;
+
+    float minBladeHeight = 0.5f;
+    float maxBladeHeight = 1.5f;
+
+    //full density between these heights, fading to none over heightFade past either end
+    float minHeight = 0.1f;
+    float maxHeight = 0.7f;
+    float heightFade = 0.1f;
+
+    //full density up to flatSlope, none past maxSlope
+    float flatSlope = 0.4f;
+    float maxSlope = 1.f;
+};
+
+// Everything terrain generation depends on. The same config always generates
+// bit-identical chunks, whatever thread or machine does it, so it is also what
+// cached chunks are checked against
+struct WorldConfig
+{
+    int seed = 1337;
+
+    //FastNoise frequency, applied on top of the octave scales
+    float frequency = 0.01f;
+
+    std::vector<NoiseOctave> octaves = { { 0.25f, 0.8f }, { 1.f, 0.2f } };
+
+    //world space height of a noise value of 1
+    int heightScale = 256;
+
+    //quads per chunk side, at most 254 since vertices store grid positions in 8 bits
+    int terrainSize = 128;
+
+    //scattered from the chunk's vertices, not part of getGeneratorHash
+    GrassConfig grass;
+
+    // noise set up for this config, generation must only use noise made here
+    FastNoise createNoise() const
+    {
+        FastNoise noise;
+        noise.SetSeed(seed);
+        noise.SetFrequency(frequency);
+        return noise;
+    }
+
+    // hash of everything except the seed, chunks with equal seeds and equal
+    // generator hashes are interchangeable
+    uint64_t getGeneratorHash() const
+    {
+        uint64_t h = 14695981039346656037ull;
+        mix(h, &frequency, sizeof(frequency));
+        mix(h, &heightScale, sizeof(heightScale));
+        mix(h, &terrainSize, sizeof(terrainSize));
+        for(const NoiseOctave& octave : octaves)
+        {
+            mix(h, &octave.scale, sizeof(octave.scale));
+            mix(h, &octave.weight, sizeof(octave.weight));
+        }
+        return h;
+    }
+
+private:
+
+    //FNV-1a
+    static void mix(uint64_t& h, const void* data, size_t size)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for(size_t i = 0; i < size; ++i)
+        {
+            h ^= bytes[i];
+            h *= 1099511628211ull;
+        }
+    }
+};
+
+#endif